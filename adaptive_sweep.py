@@ -0,0 +1,166 @@
+import argparse
+import csv
+import math
+import os
+from concurrent.futures import ThreadPoolExecutor
+
+import run_sim
+from result_store import ResultStore
+
+# Sweep over (burst, queueSize, trafficRatio) that starts from a coarse grid
+# and bisects only the intervals between neighbouring points whose
+# estimation error differs by more than a tolerance (or flips sign). Bursts
+# and queue sizes are bisected geometrically, ratios linearly. Runs are
+# looked up in the result store, so points simulated before are free.
+
+ONE_PACKET = 1500 # B
+MIN_LOSSES = 15 # fewer losses give no estimate, see analyse_run
+
+AXES = ["burst", "queue", "ratio"]
+
+
+def coarse_axes(command):
+    # the corners and middle of the usual range of get_grid
+    bursts = [ONE_PACKET, 8 * ONE_PACKET, 100 * ONE_PACKET]
+    queues = [ONE_PACKET, 4 * ONE_PACKET, 40 * ONE_PACKET]
+    ratios = [0.5, 1.0, 2.0] if command == run_sim.COM_YTOPO else [1.0]
+    return bursts, queues, ratios
+
+
+def queue_arg(queue):
+    return f"{queue}B"
+
+
+def midpoint(axis, low, high):
+    """Bisects an interval, or returns None when it is as fine as it gets."""
+    if axis == "ratio":
+        mid = round((low + high) / 2, 2)
+    else:
+        mid = int(round(math.sqrt(low * high)))
+        # no finer than a tenth of a packet
+        if high - low < ONE_PACKET / 10:
+            return None
+    return mid if low < mid < high else None
+
+
+class AdaptiveSweep:
+    def __init__(self, command, estimation, tolerance, jobs, reno, timeout, max_runs):
+        self.command = command
+        self.scenario = run_sim.SCENARIO_NAMES[command]
+        self.estimation = estimation
+        self.tolerance = tolerance
+        self.jobs = jobs
+        self.reno = reno
+        self.timeout = timeout
+        self.max_runs = max_runs
+        self.command_base = run_sim.get_complete_command(command, no_build=True)
+        self.store = ResultStore(os.path.join(os.path.dirname(os.path.abspath(__file__)), "data"))
+        self.errors = {} # (burst, queue, ratio) -> error, None when the run failed
+        self.rounds = {}
+        self.simulated = 0
+
+    def error(self, point):
+        burst, queue, ratio = point
+        params = {"burst": burst, "queueSize": queue_arg(queue), "reno": int(self.reno)}
+        if self.command == run_sim.COM_YTOPO:
+            params["trafficRatio"] = ratio
+        records = self.store.find(self.scenario, **params)
+        if not records:
+            return None
+        results = records[-1]["results"]
+        rx_rate = results.get("rx_rate", 0)
+        rate = results.get(f"{self.estimation}_rate", 0)
+        if results.get("drops", 0) < MIN_LOSSES or not rx_rate:
+            return 1.0
+        return (rate - rx_rate) / rx_rate
+
+    def run_round(self, points, round_number):
+        points = [p for p in points if p not in self.errors]
+        if self.max_runs:
+            points = points[:max(0, self.max_runs - self.simulated)]
+        if not points:
+            return []
+
+        print(f"\n*** Round {round_number}: {len(points)} points ***")
+
+        def run(point):
+            burst, queue, ratio = point
+            # the simulation skips the point itself if the store has it
+            run_sim.run_simulation_oneshot(burst, queue_arg(queue), ratio, self.command,
+                                           self.command_base, self.reno, self.timeout)
+            return point
+
+        with ThreadPoolExecutor(max_workers=self.jobs) as pool:
+            done = list(pool.map(run, points))
+        for point in done:
+            self.errors[point] = self.error(point)
+            self.rounds[point] = round_number
+            print(f"burst {point[0]}B, queueSize {point[1]}B, ratio {point[2]}: error {self.errors[point]}")
+        self.simulated += len(done)
+        return done
+
+    def refinements(self):
+        """Midpoints of the intervals whose ends disagree by more than the tolerance."""
+        new_points = set()
+        for index, axis in enumerate(AXES):
+            # neighbours along one axis share the other two coordinates
+            lines = {}
+            for point, error in self.errors.items():
+                if error is None:
+                    continue
+                key = point[:index] + point[index + 1:]
+                lines.setdefault(key, []).append((point[index], error))
+            for key, values in lines.items():
+                values.sort()
+                for (low, low_error), (high, high_error) in zip(values, values[1:]):
+                    flips = (low_error < 0) != (high_error < 0)
+                    if not flips and abs(high_error - low_error) <= self.tolerance:
+                        continue
+                    mid = midpoint(axis, low, high)
+                    if mid is not None:
+                        new_points.add(key[:index] + (mid,) + key[index:])
+        return sorted(new_points)
+
+    def run(self, max_rounds):
+        bursts, queues, ratios = coarse_axes(self.command)
+        points = [(b, q, r) for r in ratios for b in bursts for q in queues]
+        for round_number in range(max_rounds + 1):
+            if not self.run_round(points, round_number):
+                break
+            points = self.refinements()
+
+    def save(self, path):
+        with open(path, "w", newline="") as f:
+            writer = csv.writer(f)
+            writer.writerow(["burst", "queue_size", "traffic_ratio", "error_rate", "round"])
+            for point in sorted(self.errors):
+                writer.writerow([point[0], point[1], point[2], self.errors[point], self.rounds[point]])
+        print(f"{len(self.errors)} points written to {path}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Sweep that refines around estimation-error transitions.")
+    parser.add_argument("--command", choices=list(run_sim.SCENARIO_NAMES), required=True,
+                        help="Simulation to sweep.")
+    parser.add_argument("--estimation", default="google",
+                        help="Online estimate the error is taken from (<name>_rate in the metadata).")
+    parser.add_argument("--tolerance", type=float, default=0.05,
+                        help="Error difference between neighbours above which their interval is bisected.")
+    parser.add_argument("--rounds", type=int, default=5,
+                        help="Maximum number of refinement rounds.")
+    parser.add_argument("--max-runs", type=int, default=0,
+                        help="Stop after this many points, 0 for no limit.")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(),
+                        help="Number of simulations to run in parallel.")
+    parser.add_argument("--timeout", type=int, default=run_sim.DEFAULT_TIMEOUT,
+                        help="Timeout of a single simulation in seconds.")
+    parser.add_argument("--reno", action="store_true",
+                        help="Enable TCP NewReno in the simulation.")
+    args = parser.parse_args()
+
+    run_sim.run_build()
+    sweep = AdaptiveSweep(args.command, args.estimation, args.tolerance, args.jobs,
+                          args.reno, args.timeout, args.max_runs)
+    sweep.run(args.rounds)
+    sweep.save(os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                            f"data/adaptive_{args.command}.csv"))
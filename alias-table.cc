@@ -0,0 +1,51 @@
+#include "alias-table.h"
+
+#include <algorithm>
+#include <map>
+
+AliasTable::AliasTable(const std::vector<uint32_t> &samples) {
+  std::map<uint32_t, uint64_t> counts;
+  for (uint32_t value : samples)
+    counts[value]++;
+
+  size_t n = counts.size();
+  m_probability.assign(n, 0.0);
+  m_alias.assign(n, 0);
+
+  // scaled so that the average column holds exactly 1
+  std::vector<double> scaled;
+  for (const auto &count : counts) {
+    m_values.push_back(count.first);
+    scaled.push_back(static_cast<double>(count.second) * n / samples.size());
+  }
+
+  std::vector<uint32_t> small, large;
+  for (uint32_t i = 0; i < n; i++)
+    (scaled[i] < 1.0 ? small : large).push_back(i);
+
+  while (!small.empty() && !large.empty()) {
+    uint32_t less = small.back();
+    uint32_t more = large.back();
+    small.pop_back();
+    m_probability[less] = scaled[less];
+    m_alias[less] = more;
+    scaled[more] -= 1.0 - scaled[less];
+    if (scaled[more] < 1.0) {
+      large.pop_back();
+      small.push_back(more);
+    }
+  }
+  // what is left is 1 up to rounding
+  for (uint32_t i : large)
+    m_probability[i] = 1.0;
+  for (uint32_t i : small)
+    m_probability[i] = 1.0;
+}
+
+size_t AliasTable::GetValueCount() const { return m_values.size(); }
+
+uint32_t AliasTable::Draw(double u1, double u2) const {
+  size_t column = std::min<size_t>(u1 * m_values.size(), m_values.size() - 1);
+  return u2 < m_probability[column] ? m_values[column]
+                                    : m_values[m_alias[column]];
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Walker's alias method over the distinct values of a sample, each weighted
+// by how often it occurs, so an i.i.d. draw costs O(1) for any number of
+// distinct values.
+class AliasTable {
+public:
+  explicit AliasTable(const std::vector<uint32_t> &samples);
+
+  size_t GetValueCount() const;
+
+  // u1 and u2 in [0, 1)
+  uint32_t Draw(double u1, double u2) const;
+
+private:
+  std::vector<uint32_t> m_values;
+  std::vector<double> m_probability;
+  std::vector<uint32_t> m_alias;
+};
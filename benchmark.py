@@ -0,0 +1,241 @@
+import argparse
+import csv
+import json
+import os
+import re
+import shutil
+import subprocess
+import tempfile
+import time
+
+from run_sim import COMMAND_BASE, get_complete_command, run_build
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# wall time per simulated second of the aggregate scenario as the number of
+# flows grows; needs sim-aggregate/WeHeY-simulation-aggregate.cc in the main directory
+COMMAND = "aggregate"
+WALL_PER_SIM_RE = re.compile(r"Wall time per simulated second: ([\d.eE+-]+) s")
+
+RESULTS_FILE = "data/benchmark_aggregate.csv"
+
+# cost of every scenario at fixed parameters, for each access-link rate
+# (--LinkRate); each run appends one JSON line, so regressions show up
+# against earlier commits
+SUITE_FILE = "data/benchmark_suite.jsonl"
+DEFAULT_LINK_RATES = ["20Mbps", "200Mbps", "1000Mbps"]
+
+# the mains of the main directory wait here during the suite; if the suite is
+# killed, the next run (or `python benchmark.py --restore`) puts them back
+STASH_DIR = ".benchmark_mains"
+
+SHAPING_POINT = ["--burst=12000", "--queueSize=1500B"]
+
+# scenario -> (folder, main, options); the main is copied into this directory
+# for its runs, with the sources of its folder that are not here already.
+# The MPI variant needs an MPI build and mpirun, so it is not in the suite.
+SCENARIOS = {
+    "default": ("sim-default", "WeHeY-simulation.cc", ["--burst=12000"]),
+    "custom-send": ("sim-custom-packet", "WeHeY-simulation-custom-send.cc", ["--burst=12000"]),
+    "complex": ("sim-default-complex", "WeHeY-simulation-complex.cc", ["--burst=12000"]),
+    "shaping": ("sim-shaping", "WeHeY-simulation-shaping.cc", SHAPING_POINT),
+    "complex-shaping": ("sim-shaping-complex", "WeHeY-simulation-complex-shaping.cc", SHAPING_POINT),
+    "sample-shaping": ("sim-shaping-sample", "WeHeY-simulation-shaping-sample.cc", SHAPING_POINT),
+    "wehe-trace-shaping": ("sim-shaping-weheTrace", "WeHeY-simulation-shaping-complex.cc", SHAPING_POINT),
+    "xtopo": ("sim-two-servers", "WeHeY-simulation-two-servers.cc", SHAPING_POINT + ["--trafficRatio=1"]),
+    "aggregate": ("sim-aggregate", "WeHeY-simulation-aggregate.cc", SHAPING_POINT + ["--flows=100"]),
+}
+
+# printed by runAndPrintCost in utils.cc
+COST_RE = {
+    "events": (re.compile(r"Events executed: (\d+)"), int),
+    "simulated_time": (re.compile(r"Simulated time: ([\d.eE+-]+) s"), float),
+    "wall_time": (re.compile(r"Wall time: ([\d.eE+-]+) s"), float),
+    # of the whole simulation process, setup included
+    "process_peak_rss_kb": (re.compile(r"Process peak RSS: (\d+) kB"), int),
+}
+
+
+def run_point(flows, simulation_time, timeout):
+    command = get_complete_command(COMMAND, no_build=True) + [
+        "--",
+        f"--flows={flows}",
+        f"--simulationTime={simulation_time}",
+        "--Pcap=0",
+        "--RunId=benchmark",
+        "--SkipCompleted=0",
+    ]
+    try:
+        result = subprocess.run(command, cwd=HERE, check=True, text=True,
+                                capture_output=True, timeout=timeout)
+    except subprocess.TimeoutExpired:
+        print(f"{flows} flows: timed out after {timeout} seconds")
+        return None
+    except subprocess.CalledProcessError as e:
+        print(f"{flows} flows: simulation failed\n{e.stderr}")
+        return None
+
+    match = WALL_PER_SIM_RE.search(result.stdout)
+    return float(match.group(1)) if match else None
+
+
+def run_flows(flow_counts, simulation_time, timeout):
+    run_build()
+    rows = []
+    for flows in flow_counts:
+        wall_per_sim = run_point(flows, simulation_time, timeout)
+        if wall_per_sim is None:
+            continue
+        rows.append({"flows": flows, "wall_per_sim_second": wall_per_sim,
+                     "wall_per_sim_second_per_flow": wall_per_sim / flows})
+        print(f"{flows:>6} flows: {wall_per_sim:.3f} s wall per simulated second")
+
+    path = os.path.join(HERE, RESULTS_FILE)
+    with open(path, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=["flows", "wall_per_sim_second", "wall_per_sim_second_per_flow"])
+        writer.writeheader()
+        writer.writerows(rows)
+    print(f"Results written to {path}")
+
+
+def get_commit():
+    try:
+        result = subprocess.run(["git", "rev-parse", "--short", "HEAD"], cwd=HERE,
+                                check=True, text=True, capture_output=True)
+    except (OSError, subprocess.CalledProcessError):
+        return ""
+    return result.stdout.strip()
+
+
+def directory_size(path):
+    """Bytes of every output file under path, the result store excluded."""
+    total = 0
+    for root, _, files in os.walk(path):
+        for name in files:
+            if name != "wehe_results.jsonl":
+                total += os.path.getsize(os.path.join(root, name))
+    return total
+
+
+def run_scenario_rate(main, options, link_rate, timeout):
+    target = COMMAND_BASE[2].rsplit("/", 1)[0] + "/" + main[:-len(".cc")]
+    output_root = tempfile.mkdtemp(prefix="wehe_benchmark_")
+    command = [COMMAND_BASE[0], COMMAND_BASE[1], "--no-build", target, "--"] + options + [
+        f"--LinkRate={link_rate}",
+        f"--OutputRoot={output_root}/",
+        "--SkipCompleted=0",
+    ]
+    try:
+        start = time.time()
+        result = subprocess.run(command, cwd=HERE, check=True, text=True,
+                                capture_output=True, timeout=timeout)
+        process_time = time.time() - start
+
+        costs = {}
+        for name, (regex, parse) in COST_RE.items():
+            match = regex.search(result.stdout)
+            if match is None:
+                print(f"No run cost in the output of {main}")
+                return None
+            costs[name] = parse(match.group(1))
+        costs["trace_bytes"] = directory_size(output_root)
+    except subprocess.TimeoutExpired:
+        print(f"{main} at {link_rate}: timed out after {timeout} seconds")
+        return None
+    except subprocess.CalledProcessError as e:
+        print(f"{main} at {link_rate}: simulation failed\n{e.stderr}")
+        return None
+    finally:
+        shutil.rmtree(output_root, ignore_errors=True)
+
+    wall_time = costs["wall_time"]
+    costs["events_per_second"] = costs["events"] / wall_time if wall_time else None
+    costs["sim_seconds_per_wall_second"] = costs["simulated_time"] / wall_time if wall_time else None
+    # the wrapper, topology setup and output on top of Simulator::Run
+    costs["process_time"] = process_time
+    return costs
+
+
+def restore_mains():
+    """Put back the mains a run_suite that did not finish left in STASH_DIR."""
+    stash = os.path.join(HERE, STASH_DIR)
+    if not os.path.isdir(stash):
+        return
+    for name in os.listdir(stash):
+        if not os.path.exists(os.path.join(HERE, name)):
+            shutil.copy2(os.path.join(stash, name), os.path.join(HERE, name))
+        os.remove(os.path.join(stash, name))
+    os.rmdir(stash)
+
+
+def run_suite(scenarios, link_rates, timeout):
+    commit = get_commit()
+    date = time.strftime("%Y-%m-%dT%H:%M:%S")
+    path = os.path.join(HERE, SUITE_FILE)
+
+    # the main directory takes one main at a time; whatever is there now is
+    # copied aside first and only removed once the copy exists
+    restore_mains()
+    stash = os.path.join(HERE, STASH_DIR)
+    os.makedirs(stash)
+    stashed = [name for name in os.listdir(HERE) if name.startswith("WeHeY-simulation") and name.endswith(".cc")]
+    for name in stashed:
+        shutil.copy2(os.path.join(HERE, name), os.path.join(stash, name))
+    for name in stashed:
+        os.remove(os.path.join(HERE, name))
+
+    try:
+        for scenario in scenarios:
+            folder, main, options = SCENARIOS[scenario]
+            copied = []
+            for name in os.listdir(os.path.join(HERE, folder)):
+                if not os.path.exists(os.path.join(HERE, name)):
+                    shutil.copy(os.path.join(HERE, folder, name), os.path.join(HERE, name))
+                    copied.append(name)
+            try:
+                print(f"\n*** {scenario} ***")
+                if not run_build():
+                    continue
+                for link_rate in link_rates:
+                    costs = run_scenario_rate(main, options, link_rate, timeout)
+                    if costs is None:
+                        continue
+                    record = {"scenario": scenario, "link_rate": link_rate, "commit": commit, "date": date}
+                    record.update(costs)
+                    with open(path, "a") as f:
+                        f.write(json.dumps(record) + "\n")
+                    print(f"{scenario} at {link_rate}: {costs['wall_time']:.2f} s wall, "
+                          f"{costs['events']:.0f} events ({costs['events_per_second'] or 0:.0f}/s), "
+                          f"{costs['sim_seconds_per_wall_second'] or 0:.3f} simulated s per wall s, "
+                          f"{costs['process_peak_rss_kb'] / 1024:.1f} MB process peak RSS, "
+                          f"{costs['trace_bytes'] / 1e6:.1f} MB of traces")
+            finally:
+                for name in copied:
+                    os.remove(os.path.join(HERE, name))
+    finally:
+        restore_mains()
+    print(f"Results appended to {path}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Benchmark the simulations.")
+    parser.add_argument("--scenarios", nargs="+", choices=list(SCENARIOS), default=list(SCENARIOS),
+                        help="Scenarios of the suite to run.")
+    parser.add_argument("--link-rates", nargs="+", default=DEFAULT_LINK_RATES,
+                        help="Access-link rates every scenario runs at.")
+    parser.add_argument("--flows", type=int, nargs="+",
+                        help="Instead of the suite, run the aggregate scenario with these numbers of flows.")
+    parser.add_argument("--simulation-time", type=float, default=3.0,
+                        help="Simulated seconds per run with --flows.")
+    parser.add_argument("--timeout", type=int, default=3600,
+                        help="Timeout of a single run in seconds.")
+    parser.add_argument("--restore", action="store_true",
+                        help=f"Only put back the mains left in {STASH_DIR} by an interrupted suite.")
+    args = parser.parse_args()
+
+    if args.restore:
+        restore_mains()
+    elif args.flows:
+        run_flows(args.flows, args.simulation_time, args.timeout)
+    else:
+        run_suite(args.scenarios, args.link_rates, args.timeout)
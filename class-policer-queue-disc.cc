@@ -0,0 +1,511 @@
+#include "class-policer-queue-disc.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/tcp-header.h"
+#include "ns3/udp-header.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("ClassPolicerQueueDisc");
+
+NS_OBJECT_ENSURE_REGISTERED(ClassPolicerQueueDisc);
+
+static const uint8_t PROTOCOL_TCP = 6;
+static const uint8_t PROTOCOL_UDP = 17;
+
+const uint32_t PolicerClassTable::NOT_FOUND;
+
+PolicerClassKey::PolicerClassKey()
+    : type(NONE), protocol(0), dscp(0), srcPort(0), dstPort(0), src(0),
+      dst(0) {}
+
+bool PolicerClassKey::operator==(const PolicerClassKey &other) const {
+  return type == other.type && protocol == other.protocol &&
+         dscp == other.dscp && srcPort == other.srcPort &&
+         dstPort == other.dstPort && src == other.src && dst == other.dst;
+}
+
+PolicerClassTable::PolicerClassTable() : m_size(0) {
+  m_slots.resize(16, Slot{PolicerClassKey(), NOT_FOUND});
+}
+
+uint64_t PolicerClassTable::Hash(const PolicerClassKey &key) {
+  // splitmix64 finalizer over the key packed in two words
+  auto mix = [](uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  };
+  uint64_t first = uint64_t(key.type) | uint64_t(key.protocol) << 8 |
+                   uint64_t(key.dscp) << 16 | uint64_t(key.srcPort) << 32 |
+                   uint64_t(key.dstPort) << 48;
+  uint64_t second = uint64_t(key.src) << 32 | key.dst;
+  return mix(first) ^ mix(second);
+}
+
+void PolicerClassTable::Grow() {
+  std::vector<Slot> slots(m_slots.size() * 2,
+                          Slot{PolicerClassKey(), NOT_FOUND});
+  slots.swap(m_slots);
+  m_size = 0;
+  for (const Slot &slot : slots) {
+    if (slot.index != NOT_FOUND)
+      Insert(slot.key, slot.index);
+  }
+}
+
+void PolicerClassTable::Insert(const PolicerClassKey &key, uint32_t index) {
+  if ((m_size + 1) * 2 > m_slots.size())
+    Grow();
+
+  size_t mask = m_slots.size() - 1;
+  for (size_t i = Hash(key) & mask;; i = (i + 1) & mask) {
+    if (m_slots[i].index == NOT_FOUND) {
+      m_slots[i] = Slot{key, index};
+      m_size++;
+      return;
+    }
+    if (m_slots[i].key == key) {
+      m_slots[i].index = index;
+      return;
+    }
+  }
+}
+
+uint32_t PolicerClassTable::Find(const PolicerClassKey &key) const {
+  size_t mask = m_slots.size() - 1;
+  for (size_t i = Hash(key) & mask;; i = (i + 1) & mask) {
+    if (m_slots[i].index == NOT_FOUND)
+      return NOT_FOUND;
+    if (m_slots[i].key == key)
+      return m_slots[i].index;
+  }
+}
+
+uint32_t PolicerClassTable::GetSize() const { return m_size; }
+
+TypeId ClassPolicerQueueDisc::GetTypeId(void) {
+  static TypeId tid =
+      TypeId("ns3::ClassPolicerQueueDisc")
+          .SetParent<QueueDisc>()
+          .SetGroupName("TrafficControl")
+          .AddConstructor<ClassPolicerQueueDisc>()
+          .AddAttribute("Classes",
+                        "Policed classes, e.g. \"dport=7,burst=3000;dscp=46\"",
+                        StringValue(""),
+                        MakeStringAccessor(&ClassPolicerQueueDisc::m_classSpec),
+                        MakeStringChecker())
+          .AddAttribute("MaxSize",
+                        "Backlog limit of a class without its own queue=",
+                        QueueSizeValue(QueueSize("1000p")),
+                        MakeQueueSizeAccessor(&QueueDisc::SetMaxSize,
+                                              &QueueDisc::GetMaxSize),
+                        MakeQueueSizeChecker())
+          .AddAttribute("Burst",
+                        "Bucket size in bytes of a class without its own "
+                        "burst=",
+                        UintegerValue(125000),
+                        MakeUintegerAccessor(&ClassPolicerQueueDisc::m_burst),
+                        MakeUintegerChecker<uint32_t>())
+          .AddAttribute("Mtu", "Accepted for TBF compatibility, unused",
+                        UintegerValue(0),
+                        MakeUintegerAccessor(&ClassPolicerQueueDisc::m_mtu),
+                        MakeUintegerChecker<uint32_t>())
+          .AddAttribute("Rate", "Token rate of a class without its own rate=",
+                        DataRateValue(DataRate("125KB/s")),
+                        MakeDataRateAccessor(&ClassPolicerQueueDisc::m_rate),
+                        MakeDataRateChecker())
+          .AddAttribute("PeakRate", "Accepted for TBF compatibility, must be 0",
+                        DataRateValue(DataRate("0bps")),
+                        MakeDataRateAccessor(
+                            &ClassPolicerQueueDisc::m_peakRate),
+                        MakeDataRateChecker())
+          .AddAttribute("BypassMaxSize",
+                        "Size of the queue of traffic that matches no class",
+                        QueueSizeValue(QueueSize("1000p")),
+                        MakeQueueSizeAccessor(
+                            &ClassPolicerQueueDisc::m_bypassSize),
+                        MakeQueueSizeChecker());
+  return tid;
+}
+
+ClassPolicerQueueDisc::ClassPolicerQueueDisc()
+    : QueueDisc(QueueDiscSizePolicy::MULTIPLE_QUEUES), m_keyTypes(0) {}
+
+ClassPolicerQueueDisc::~ClassPolicerQueueDisc() {}
+
+void ClassPolicerQueueDisc::DoDispose(void) {
+  for (PolicerClass &policerClass : m_classes)
+    Simulator::Cancel(policerClass.releaseEvent);
+  m_classes.clear();
+  m_released.clear();
+  QueueDisc::DoDispose();
+}
+
+void ClassPolicerQueueDisc::AddClass(const PolicerClassKey &key,
+                                     uint32_t burst, DataRate rate,
+                                     std::string maxSize) {
+  NS_ABORT_MSG_IF(!m_classes.empty(),
+                  "Classes must be added before the queue disc starts");
+  m_specs.push_back(ClassSpec{key, burst, rate, maxSize});
+}
+
+uint32_t ClassPolicerQueueDisc::GetNClasses() const {
+  return m_classes.size();
+}
+
+uint64_t ClassPolicerQueueDisc::GetClassPackets(uint32_t index) const {
+  NS_ASSERT_MSG(index < m_classes.size(), "No policer class " << index);
+  return m_classes[index].packets;
+}
+
+uint64_t ClassPolicerQueueDisc::GetClassDrops(uint32_t index) const {
+  NS_ASSERT_MSG(index < m_classes.size(), "No policer class " << index);
+  return m_classes[index].drops;
+}
+
+static uint16_t ParsePort(const std::string &value) {
+  uint32_t port = std::stoul(value);
+  if (port > 65535)
+    throw std::invalid_argument(value);
+  return port;
+}
+
+// 10.1.1.1:49153>10.1.2.2:7/tcp
+static PolicerClassKey ParseFlow(const std::string &value) {
+  size_t arrow = value.find('>');
+  size_t slash = value.find('/');
+  size_t srcColon = value.rfind(':', arrow);
+  size_t dstColon = value.rfind(':', slash);
+  if (arrow == std::string::npos || slash == std::string::npos ||
+      srcColon == std::string::npos || dstColon == std::string::npos ||
+      dstColon < arrow)
+    throw std::invalid_argument(value);
+
+  PolicerClassKey key;
+  key.type = PolicerClassKey::FLOW;
+  key.src = Ipv4Address(value.substr(0, srcColon).c_str()).Get();
+  key.srcPort = ParsePort(value.substr(srcColon + 1, arrow - srcColon - 1));
+  key.dst =
+      Ipv4Address(value.substr(arrow + 1, dstColon - arrow - 1).c_str()).Get();
+  key.dstPort = ParsePort(value.substr(dstColon + 1, slash - dstColon - 1));
+  std::string protocol = value.substr(slash + 1);
+  if (protocol == "tcp")
+    key.protocol = PROTOCOL_TCP;
+  else if (protocol == "udp")
+    key.protocol = PROTOCOL_UDP;
+  else
+    key.protocol = std::stoul(protocol);
+  return key;
+}
+
+void ClassPolicerQueueDisc::ParseClasses(const std::string &spec) {
+  std::istringstream classes(spec);
+  std::string entry;
+  while (std::getline(classes, entry, ';')) {
+    if (entry.empty())
+      continue;
+
+    ClassSpec parsed{PolicerClassKey(), 0, DataRate(0), ""};
+    std::istringstream fields(entry);
+    std::string field;
+    try {
+      while (std::getline(fields, field, ',')) {
+        size_t equals = field.find('=');
+        if (equals == std::string::npos)
+          throw std::invalid_argument(field);
+        std::string name = field.substr(0, equals);
+        std::string value = field.substr(equals + 1);
+
+        if (name == "flow") {
+          parsed.key = ParseFlow(value);
+        } else if (name == "dport") {
+          parsed.key.type = PolicerClassKey::DST_PORT;
+          parsed.key.dstPort = ParsePort(value);
+        } else if (name == "sport") {
+          parsed.key.type = PolicerClassKey::SRC_PORT;
+          parsed.key.srcPort = ParsePort(value);
+        } else if (name == "dscp") {
+          parsed.key.type = PolicerClassKey::DSCP;
+          parsed.key.dscp = std::stoul(value);
+        } else if (name == "burst") {
+          parsed.burst = std::stoul(value);
+        } else if (name == "rate") {
+          parsed.rate = DataRate(value);
+        } else if (name == "queue") {
+          parsed.maxSize = value;
+        } else {
+          throw std::invalid_argument(field);
+        }
+      }
+    } catch (const std::exception &) {
+      NS_FATAL_ERROR("Invalid policer class \"" << entry << "\"");
+    }
+    if (parsed.key.type == PolicerClassKey::NONE)
+      NS_FATAL_ERROR("Policer class without flow=, dport=, sport= or dscp=: "
+                     << entry);
+    m_specs.push_back(parsed);
+  }
+}
+
+uint32_t ClassPolicerQueueDisc::Classify(Ptr<QueueDiscItem> item) const {
+  Ptr<Ipv4QueueDiscItem> ipItem = DynamicCast<Ipv4QueueDiscItem>(item);
+  if (!ipItem || m_keyTypes == 0)
+    return PolicerClassTable::NOT_FOUND;
+
+  const Ipv4Header &header = ipItem->GetHeader();
+  uint8_t protocol = header.GetProtocol();
+  uint16_t srcPort = 0, dstPort = 0;
+  if (protocol == PROTOCOL_TCP) {
+    TcpHeader tcpHeader;
+    if (item->GetPacket()->PeekHeader(tcpHeader)) {
+      srcPort = tcpHeader.GetSourcePort();
+      dstPort = tcpHeader.GetDestinationPort();
+    }
+  } else if (protocol == PROTOCOL_UDP) {
+    UdpHeader udpHeader;
+    if (item->GetPacket()->PeekHeader(udpHeader)) {
+      srcPort = udpHeader.GetSourcePort();
+      dstPort = udpHeader.GetDestinationPort();
+    }
+  }
+
+  // most specific first, one lookup per key type in use
+  uint32_t index = PolicerClassTable::NOT_FOUND;
+  if (m_keyTypes & (1 << PolicerClassKey::FLOW)) {
+    PolicerClassKey key;
+    key.type = PolicerClassKey::FLOW;
+    key.protocol = protocol;
+    key.srcPort = srcPort;
+    key.dstPort = dstPort;
+    key.src = header.GetSource().Get();
+    key.dst = header.GetDestination().Get();
+    index = m_table.Find(key);
+  }
+  if (index == PolicerClassTable::NOT_FOUND &&
+      (m_keyTypes & (1 << PolicerClassKey::DST_PORT)) && dstPort != 0) {
+    PolicerClassKey key;
+    key.type = PolicerClassKey::DST_PORT;
+    key.dstPort = dstPort;
+    index = m_table.Find(key);
+  }
+  if (index == PolicerClassTable::NOT_FOUND &&
+      (m_keyTypes & (1 << PolicerClassKey::SRC_PORT)) && srcPort != 0) {
+    PolicerClassKey key;
+    key.type = PolicerClassKey::SRC_PORT;
+    key.srcPort = srcPort;
+    index = m_table.Find(key);
+  }
+  if (index == PolicerClassTable::NOT_FOUND &&
+      (m_keyTypes & (1 << PolicerClassKey::DSCP))) {
+    PolicerClassKey key;
+    key.type = PolicerClassKey::DSCP;
+    key.dscp = header.GetDscp();
+    index = m_table.Find(key);
+  }
+  return index;
+}
+
+uint32_t
+ClassPolicerQueueDisc::ClassBurst(const PolicerClass &policerClass) const {
+  return policerClass.burst ? policerClass.burst : m_burst;
+}
+
+double
+ClassPolicerQueueDisc::ClassRate(const PolicerClass &policerClass) const {
+  return policerClass.rate > 0 ? policerClass.rate
+                               : m_rate.GetBitRate() / 8.0;
+}
+
+QueueSize
+ClassPolicerQueueDisc::ClassMaxSize(const PolicerClass &policerClass) const {
+  return policerClass.hasMaxSize ? policerClass.maxSize : GetMaxSize();
+}
+
+void ClassPolicerQueueDisc::Refill(PolicerClass &policerClass) {
+  Time now = Simulator::Now();
+  double elapsed = std::max(0.0, (now - policerClass.lastRefill).GetSeconds());
+  policerClass.lastRefill = now;
+  // clamped even without new tokens, so a smaller Burst applies at once
+  policerClass.tokens =
+      std::min<double>(ClassBurst(policerClass),
+                       policerClass.tokens + ClassRate(policerClass) * elapsed);
+}
+
+Time ClassPolicerQueueDisc::TimeToConform(const PolicerClass &policerClass,
+                                          uint32_t size) const {
+  double wait =
+      std::max(0.0, (size - policerClass.tokens) / ClassRate(policerClass));
+  // rounded up, so that the release never comes before the tokens
+  return NanoSeconds(std::max<int64_t>(1, std::ceil(wait * 1e9)));
+}
+
+bool ClassPolicerQueueDisc::ExceedsLimit(const PolicerClass &policerClass,
+                                         uint32_t size) const {
+  QueueSize maxSize = ClassMaxSize(policerClass);
+  if (maxSize.GetUnit() == QueueSizeUnit::PACKETS)
+    return policerClass.waiting.size() + 1 > maxSize.GetValue();
+  return policerClass.waitingBytes + size > maxSize.GetValue();
+}
+
+bool ClassPolicerQueueDisc::DoEnqueue(Ptr<QueueDiscItem> item) {
+  NS_LOG_FUNCTION(this << item);
+
+  uint32_t index = Classify(item);
+  if (index == PolicerClassTable::NOT_FOUND) {
+    // a full bypass queue reports the drop itself
+    if (!GetInternalQueue(0)->Enqueue(item))
+      return false;
+    m_released.push_back(0);
+    return true;
+  }
+
+  PolicerClass &policerClass = m_classes[index];
+  Refill(policerClass);
+  uint32_t size = item->GetSize();
+
+  if (policerClass.waiting.empty() && policerClass.tokens >= size) {
+    policerClass.tokens -= size;
+    policerClass.packets++;
+    GetInternalQueue(index + 1)->Enqueue(item);
+    m_released.push_back(index + 1);
+    return true;
+  }
+
+  // never conforms, however much room its class queue has
+  if (size > ClassBurst(policerClass)) {
+    policerClass.drops++;
+    DropBeforeEnqueue(item, OUT_OF_PROFILE_DROP);
+    return false;
+  }
+
+  if (ExceedsLimit(policerClass, size)) {
+    policerClass.drops++;
+    DropBeforeEnqueue(item, ClassMaxSize(policerClass).GetValue() == 0
+                                ? OUT_OF_PROFILE_DROP
+                                : CLASS_LIMIT_DROP);
+    return false;
+  }
+
+  // waits behind the released packets of its class for its tokens
+  GetInternalQueue(index + 1)->Enqueue(item);
+  policerClass.waiting.push_back(size);
+  policerClass.waitingBytes += size;
+  if (!policerClass.releaseEvent.IsRunning()) {
+    policerClass.releaseEvent = Simulator::Schedule(
+        TimeToConform(policerClass, policerClass.waiting.front()),
+        &ClassPolicerQueueDisc::Release, this, index);
+  }
+  return true;
+}
+
+void ClassPolicerQueueDisc::Release(uint32_t index) {
+  PolicerClass &policerClass = m_classes[index];
+  Refill(policerClass);
+
+  bool released = false;
+  while (!policerClass.waiting.empty() &&
+         policerClass.tokens >= policerClass.waiting.front()) {
+    uint32_t size = policerClass.waiting.front();
+    policerClass.waiting.pop_front();
+    policerClass.waitingBytes -= size;
+    policerClass.tokens -= size;
+    policerClass.packets++;
+    m_released.push_back(index + 1);
+    released = true;
+  }
+
+  if (!policerClass.waiting.empty()) {
+    policerClass.releaseEvent = Simulator::Schedule(
+        TimeToConform(policerClass, policerClass.waiting.front()),
+        &ClassPolicerQueueDisc::Release, this, index);
+  }
+  if (released)
+    Run();
+}
+
+Ptr<const QueueDiscItem> ClassPolicerQueueDisc::DoPeek(void) {
+  if (m_released.empty())
+    return 0;
+  return GetInternalQueue(m_released.front())->Peek();
+}
+
+Ptr<QueueDiscItem> ClassPolicerQueueDisc::DoDequeue(void) {
+  NS_LOG_FUNCTION(this);
+
+  if (m_released.empty())
+    return 0;
+  uint32_t queue = m_released.front();
+  m_released.pop_front();
+  return GetInternalQueue(queue)->Dequeue();
+}
+
+bool ClassPolicerQueueDisc::CheckConfig(void) {
+  if (GetNQueueDiscClasses() > 0 || GetNPacketFilters() > 0) {
+    NS_LOG_ERROR("ClassPolicerQueueDisc cannot have classes or packet "
+                 "filters, its classes are given by the Classes attribute");
+    return false;
+  }
+  if (m_peakRate.GetBitRate() > 0) {
+    NS_LOG_ERROR("ClassPolicerQueueDisc has no second bucket");
+    return false;
+  }
+  if (GetNInternalQueues() > 0) {
+    NS_LOG_ERROR("ClassPolicerQueueDisc creates its own queues");
+    return false;
+  }
+
+  ParseClasses(m_classSpec);
+
+  // the bypass queue, then one per class; a class's backlog is limited by
+  // its own MaxSize, the rest are packets already released to the device
+  AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem>>(
+      "MaxSize", QueueSizeValue(m_bypassSize)));
+  QueueSize unlimited(QueueSizeUnit::PACKETS,
+                      std::numeric_limits<uint32_t>::max());
+
+  for (const ClassSpec &spec : m_specs) {
+    PolicerClass policerClass;
+    policerClass.burst = spec.burst;
+    policerClass.rate = spec.rate.GetBitRate() / 8.0;
+    policerClass.hasMaxSize = !spec.maxSize.empty();
+    if (policerClass.hasMaxSize)
+      policerClass.maxSize = QueueSize(spec.maxSize);
+    policerClass.tokens = 0;
+    policerClass.waitingBytes = 0;
+    policerClass.packets = 0;
+    policerClass.drops = 0;
+    if (ClassBurst(policerClass) == 0 || ClassRate(policerClass) <= 0) {
+      NS_LOG_ERROR("Every class needs a burst and a rate above zero");
+      return false;
+    }
+
+    m_table.Insert(spec.key, m_classes.size());
+    m_keyTypes |= 1 << spec.key.type;
+    m_classes.push_back(policerClass);
+    AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem>>(
+        "MaxSize", QueueSizeValue(unlimited)));
+  }
+  return true;
+}
+
+void ClassPolicerQueueDisc::InitializeParams(void) {
+  // buckets start full, as in TBF
+  for (PolicerClass &policerClass : m_classes) {
+    policerClass.tokens = ClassBurst(policerClass);
+    policerClass.lastRefill = Simulator::Now();
+  }
+}
+
+} // namespace ns3
@@ -0,0 +1,146 @@
+#pragma once
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/queue-disc.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+// What a packet is classified by. Fields a key type does not use stay 0.
+struct PolicerClassKey {
+  enum Type : uint8_t { NONE, FLOW, DST_PORT, SRC_PORT, DSCP };
+
+  uint8_t type;
+  uint8_t protocol;
+  uint8_t dscp;
+  uint16_t srcPort;
+  uint16_t dstPort;
+  uint32_t src;
+  uint32_t dst;
+
+  PolicerClassKey();
+  bool operator==(const PolicerClassKey &other) const;
+};
+
+// Maps class keys to class indices in one flat array with linear probing,
+// kept at most half full so a lookup is a probe or two.
+class PolicerClassTable {
+public:
+  static const uint32_t NOT_FOUND = 0xffffffff;
+
+  PolicerClassTable();
+
+  // A key inserted twice keeps the later index
+  void Insert(const PolicerClassKey &key, uint32_t index);
+  uint32_t Find(const PolicerClassKey &key) const;
+  uint32_t GetSize() const;
+
+private:
+  struct Slot {
+    PolicerClassKey key;
+    uint32_t index; // NOT_FOUND for an empty slot
+  };
+
+  static uint64_t Hash(const PolicerClassKey &key);
+  void Grow();
+
+  std::vector<Slot> m_slots;
+  uint32_t m_size;
+};
+
+// Polices traffic per class, to model differentiation by content: every
+// class has its own token bucket and backlog limit, traffic that matches
+// no class passes unpoliced. Classes are given by the Classes attribute,
+//   "dport=7;flow=10.1.1.1:49153>10.1.2.2:7/tcp,burst=3000,rate=1Mbps"
+// with one of flow=, dport=, sport= or dscp= per class and optional
+// burst=, rate= and queue= (a QueueSize, 0p for a pure policer). Missing
+// values come from the Burst, Rate and MaxSize attributes, read whenever
+// they are used, so setting those later also changes these classes. Mtu
+// and PeakRate are accepted like in TbfQueueDisc, but a second bucket is
+// not supported.
+//
+// Per packet the cost is one lookup per key type in use, independent of
+// the number of classes. Packets are released to the device in the order
+// they conformed; a class only has a timer while it has a backlog.
+class ClassPolicerQueueDisc : public QueueDisc {
+public:
+  static TypeId GetTypeId(void);
+
+  ClassPolicerQueueDisc();
+  virtual ~ClassPolicerQueueDisc();
+
+  // Before the queue disc is initialized. Zero or empty values take the
+  // Burst, Rate and MaxSize attributes.
+  void AddClass(const PolicerClassKey &key, uint32_t burst = 0,
+                DataRate rate = DataRate(0), std::string maxSize = "");
+
+  uint32_t GetNClasses() const;
+  uint64_t GetClassPackets(uint32_t index) const;
+  uint64_t GetClassDrops(uint32_t index) const;
+
+  // Drop reasons
+  static constexpr const char *OUT_OF_PROFILE_DROP = "Out of profile";
+  static constexpr const char *CLASS_LIMIT_DROP = "Class queue full";
+
+private:
+  struct ClassSpec {
+    PolicerClassKey key;
+    uint32_t burst;
+    DataRate rate;
+    std::string maxSize;
+  };
+
+  // burst, rate and maxSize are the class's own values; 0 and no maxSize
+  // take the queue disc's attributes, see ClassBurst and the others
+  struct PolicerClass {
+    uint32_t burst;
+    double rate; // bytes per second
+    bool hasMaxSize;
+    QueueSize maxSize;
+    double tokens;
+    Time lastRefill;
+    std::deque<uint32_t> waiting; // sizes of the packets waiting for tokens
+    uint64_t waitingBytes;
+    EventId releaseEvent;
+    uint64_t packets;
+    uint64_t drops;
+  };
+
+  virtual bool DoEnqueue(Ptr<QueueDiscItem> item);
+  virtual Ptr<QueueDiscItem> DoDequeue(void);
+  virtual Ptr<const QueueDiscItem> DoPeek(void);
+  virtual bool CheckConfig(void);
+  virtual void InitializeParams(void);
+  virtual void DoDispose(void);
+
+  void ParseClasses(const std::string &spec);
+  uint32_t Classify(Ptr<QueueDiscItem> item) const;
+  uint32_t ClassBurst(const PolicerClass &policerClass) const;
+  double ClassRate(const PolicerClass &policerClass) const;
+  QueueSize ClassMaxSize(const PolicerClass &policerClass) const;
+  void Refill(PolicerClass &policerClass);
+  Time TimeToConform(const PolicerClass &policerClass, uint32_t size) const;
+  bool ExceedsLimit(const PolicerClass &policerClass, uint32_t size) const;
+  void Release(uint32_t index);
+
+  std::string m_classSpec;
+  uint32_t m_burst;
+  uint32_t m_mtu;
+  DataRate m_rate;
+  DataRate m_peakRate;
+  QueueSize m_bypassSize;
+
+  std::vector<ClassSpec> m_specs;
+  PolicerClassTable m_table;
+  uint32_t m_keyTypes; // bit per PolicerClassKey::Type in the table
+  std::vector<PolicerClass> m_classes;
+  // internal queue of every packet released to the device, in order;
+  // 0 is the unpoliced traffic, class i is queue i + 1
+  std::deque<uint32_t> m_released;
+};
+
+} // namespace ns3
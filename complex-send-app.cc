@@ -10,6 +10,7 @@
 #include "ns3/simulator.h"
 #include "ns3/socket-factory.h"
 #include "ns3/socket.h"
+#include "ns3/string.h"
 #include "ns3/tcp-socket-factory.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/uinteger.h"
@@ -28,6 +29,29 @@ TypeId ComplexSendApplication::GetTypeId(void) {
                         MakeBooleanAccessor(
                             &ComplexSendApplication::m_sendPacketDistribution),
                         MakeBooleanChecker())
+          .AddAttribute("PacketSizeFile",
+                        "CSV or binary file with the packet sizes of the "
+                        "trace, empty for send_data/youtube_packets.csv",
+                        StringValue(""),
+                        MakeStringAccessor(
+                            &ComplexSendApplication::m_packetSizeFile),
+                        MakeStringChecker())
+          .AddAttribute("RandomPacketSizes",
+                        "Draw the packet sizes i.i.d. from the trace's size "
+                        "distribution instead of replaying them in order",
+                        BooleanValue(false),
+                        MakeBooleanAccessor(
+                            &ComplexSendApplication::m_randomPacketSizes),
+                        MakeBooleanChecker())
+          .AddAttribute("PooledPayload",
+                        "Cut the payloads from one shared zero-filled packet "
+                        "and only build packets the socket can take; a "
+                        "packet the socket would refuse then no longer "
+                        "fires the Tx trace",
+                        BooleanValue(false),
+                        MakeBooleanAccessor(
+                            &ComplexSendApplication::m_pooledPayload),
+                        MakeBooleanChecker())
           .AddAttribute(
               "SendSize", "The amount of data to send each time.",
               UintegerValue(512),
@@ -80,6 +104,8 @@ Ptr<Socket> ComplexSendApplication::GetSocket(void) const { return m_socket; }
 
 void ComplexSendApplication::DoDispose(void) {
   m_socket = 0;
+  m_sizeSampler.reset();
+  m_payload = 0;
   // chain up
   Application::DoDispose();
 }
@@ -88,14 +114,6 @@ void ComplexSendApplication::DoDispose(void) {
 void ComplexSendApplication::StartApplication(
     void) // Called at time specified by Start
 {
-  if (m_sendPacketDistribution && m_packetSizes.empty()) {
-    // Read the packet sizes from the file
-    m_packetSizes = getPacketSizes();
-    if (m_packetSizes.empty()) {
-      NS_FATAL_ERROR("No packet sizes found in the file.");
-    }
-  }
-
   // Create the socket if not already
   if (!m_socket) {
     m_socket = Socket::CreateSocket(GetNode(), m_tid);
@@ -127,6 +145,23 @@ void ComplexSendApplication::StartApplication(
     m_socket->SetSendCallback(
         MakeCallback(&ComplexSendApplication::DataSend, this));
   }
+  if (m_sendPacketDistribution && !m_sizeSampler) {
+    // The table is loaded once per process and shared by all senders
+    std::shared_ptr<const PacketSizeTable> table;
+    try {
+      table = PacketSizeTable::Load(m_packetSizeFile.empty()
+                                        ? getPacketSizesFileName()
+                                        : m_packetSizeFile);
+    } catch (const std::exception &e) {
+      NS_FATAL_ERROR(e.what());
+    }
+    m_sizeSampler.reset(new PacketSizeSampler(
+        table,
+        m_randomPacketSizes ? PacketSizeSampler::IID
+                            : PacketSizeSampler::SEQUENTIAL,
+        m_sizeVar));
+  }
+
   if (m_connected) {
     SendData();
   }
@@ -154,7 +189,7 @@ void ComplexSendApplication::SendData(void) {
 
     if (m_sendPacketDistribution) {
       // Use the packet sizes extracted from trace
-      toSend = m_packetSizes[m_seq % m_packetSizes.size()];
+      toSend = m_sizeSampler->Next();
     } else if (m_maxPacket > 0) {
       toSend = m_sizeVar->GetInteger(m_minPacket, m_maxPacket);
     }
@@ -162,17 +197,30 @@ void ComplexSendApplication::SendData(void) {
     toSend =
         (m_maxBytes > 0) ? std::min(toSend, m_maxBytes - m_totBytes) : toSend;
     // std::cout << "sending packet at " << Simulator::Now() << std::endl;
-    Ptr<Packet> packet = Create<Packet>(toSend);
+    uint32_t payloadSize = toSend;
 
     SeqTsHeader seqTs;
     seqTs.SetSeq(m_seq++);
     toSend = toSend > (8 + 4) ? toSend - (8 + 4)
                               : toSend; // 8+4 : the size of the seqTs header
-    if (toSend > (8 + 4)) {
+    bool withHeader = toSend > (8 + 4);
+    uint32_t packetSize = payloadSize + (withHeader ? (8 + 4) : 0);
+
+    // The socket refuses a packet larger than its free buffer space, so
+    // stop before building one; DataSend resumes once space frees up
+    if (m_pooledPayload && m_socket->GetTxAvailable() < packetSize) {
+      break;
+    }
+
+    Ptr<Packet> packet = m_pooledPayload ? GetPooledPayload(payloadSize)
+                                         : Create<Packet>(payloadSize);
+    if (withHeader) {
       packet->AddHeader(seqTs);
     }
 
-    m_txTrace(packet);
+    if (!m_txTrace.IsEmpty()) {
+      m_txTrace(packet);
+    }
     int actual = m_socket->Send(packet);
     if (actual > 0) {
       // std::cout << "actual send size: " << actual << std::endl;
@@ -193,6 +241,15 @@ void ComplexSendApplication::SendData(void) {
   }
 }
 
+Ptr<Packet> ComplexSendApplication::GetPooledPayload(uint32_t size) {
+  // Fragments share the template's zero-filled buffer, only the packet
+  // object itself is new
+  if (!m_payload || m_payload->GetSize() < size) {
+    m_payload = Create<Packet>(size);
+  }
+  return m_payload->CreateFragment(0, size);
+}
+
 void ComplexSendApplication::ConnectionSucceeded(Ptr<Socket> socket) {
   m_connected = true;
   SendData();
@@ -4,6 +4,9 @@
 #include "ns3/ptr.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/traced-callback.h"
+#include "packet-size-table.h"
+
+#include <memory>
 
 
 namespace ns3 {
@@ -33,6 +36,9 @@ private:
 
   void SendData();
 
+  // Zero-filled payload of `size` bytes backed by m_payload
+  Ptr<Packet> GetPooledPayload(uint32_t size);
+
   Ptr<Socket> m_socket;
   Address m_peer;
   bool m_connected;
@@ -48,7 +54,12 @@ private:
 
   TracedCallback<Ptr<const Packet>> m_txTrace;
 
-  std::vector<uint32_t> m_packetSizes;
+  std::string m_packetSizeFile;
+  bool m_randomPacketSizes;
+  std::unique_ptr<PacketSizeSampler> m_sizeSampler;
+
+  bool m_pooledPayload;
+  Ptr<Packet> m_payload; //!< template the pooled payloads are cut from
 
 private:
   void ConnectionSucceeded(Ptr<Socket> socket);
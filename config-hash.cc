@@ -0,0 +1,27 @@
+#include "config-hash.h"
+
+#include <cstdio>
+
+static const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+static const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+ConfigHash::ConfigHash() : m_hash(FNV_OFFSET_BASIS) {}
+
+void ConfigHash::Add(const std::string &value) {
+  for (unsigned char c : value) {
+    m_hash ^= c;
+    m_hash *= FNV_PRIME;
+  }
+  // terminator
+  m_hash ^= 0xff;
+  m_hash *= FNV_PRIME;
+}
+
+uint64_t ConfigHash::Get() const { return m_hash; }
+
+std::string ConfigHash::ToString() const {
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016llx",
+                static_cast<unsigned long long>(m_hash));
+  return hex;
+}
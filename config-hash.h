@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// 64-bit FNV-1a over a sequence of strings. Every value is terminated, so
+// ("ab", "c") and ("a", "bc") hash differently.
+class ConfigHash {
+public:
+  ConfigHash();
+
+  void Add(const std::string &value);
+  uint64_t Get() const;
+  // 16 hex digits
+  std::string ToString() const;
+
+private:
+  uint64_t m_hash;
+};
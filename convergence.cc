@@ -0,0 +1,70 @@
+#include "convergence.h"
+
+#include <cmath>
+
+ConvergenceMonitor::ConvergenceMonitor()
+    : m_threshold(0), m_losses(15), m_dropTimeout(0) {
+  Reset();
+}
+
+void ConvergenceMonitor::Configure(double threshold, uint32_t losses,
+                                   double dropTimeout) {
+  m_threshold = threshold;
+  m_losses = losses;
+  m_dropTimeout = dropTimeout;
+}
+
+void ConvergenceMonitor::Reset() {
+  m_reference = -1.0;
+  m_previousRate = 0;
+  m_stableLosses = 0;
+  m_stopTime = -1.0;
+  m_stopReason = "end";
+}
+
+bool ConvergenceMonitor::Stop(double time, const std::string &reason) {
+  m_stopTime = time;
+  m_stopReason = reason;
+  return true;
+}
+
+bool ConvergenceMonitor::PacketLost(double time, double rate) {
+  m_reference = time;
+  if (m_threshold <= 0 || IsStopped())
+    return false;
+
+  // no estimate yet while the rate is 0
+  if (m_previousRate > 0 && rate > 0 &&
+      std::fabs(rate - m_previousRate) < m_threshold * m_previousRate)
+    m_stableLosses++;
+  else
+    m_stableLosses = 0;
+  m_previousRate = rate;
+
+  if (m_stableLosses >= m_losses)
+    return Stop(time, "converged");
+  return false;
+}
+
+bool ConvergenceMonitor::PacketDelivered(double time) {
+  if (m_reference < 0)
+    m_reference = time;
+  if (m_dropTimeout <= 0 || IsStopped())
+    return false;
+
+  if (time - m_reference > m_dropTimeout)
+    return Stop(time, "no_drops");
+  return false;
+}
+
+bool ConvergenceMonitor::IsStopped() const { return m_stopTime >= 0; }
+
+double ConvergenceMonitor::GetStopTime() const { return m_stopTime; }
+
+std::string ConvergenceMonitor::GetStopReason() const { return m_stopReason; }
+
+void ConvergenceMonitor::WriteMetadata(std::ostream &out) const {
+  out << "stop_reason=" << m_stopReason << std::endl;
+  if (IsStopped())
+    out << "stop_time=" << m_stopTime << std::endl;
+}
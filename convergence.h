@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Decides when a run can end before its fixed stop time. It stops once the
+// online rate estimate has changed by less than `threshold` (relative) at
+// each of the last `losses` losses, or once no packet has been dropped for
+// `dropTimeout` seconds of delivered traffic, the run is then not policed.
+// A threshold or timeout of 0 turns that rule off.
+class ConvergenceMonitor {
+public:
+  ConvergenceMonitor();
+
+  void Configure(double threshold, uint32_t losses, double dropTimeout);
+  void Reset();
+
+  // Both return true when the simulation should stop at `time`
+  bool PacketLost(double time, double rate);
+  bool PacketDelivered(double time);
+
+  bool IsStopped() const;
+  double GetStopTime() const;
+  // "converged", "no_drops", or "end" when the run was not stopped early
+  std::string GetStopReason() const;
+
+  void WriteMetadata(std::ostream &out) const;
+
+private:
+  bool Stop(double time, const std::string &reason);
+
+  double m_threshold;
+  uint32_t m_losses;
+  double m_dropTimeout;
+
+  double m_reference; // first delivery or last loss, in seconds
+  double m_previousRate;
+  uint32_t m_stableLosses;
+  double m_stopTime;
+  std::string m_stopReason;
+};
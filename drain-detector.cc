@@ -0,0 +1,90 @@
+#include "drain-detector.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+
+DrainDetector::DrainDetector(Time interval) : m_interval(interval) {
+  Reset();
+}
+
+void DrainDetector::Reset() {
+  m_cap = Seconds(0);
+  m_quietChecks = 0;
+  m_drainTime = -1.0;
+}
+
+void DrainDetector::Schedule(Time cap) {
+  m_cap = cap;
+
+  // nothing can be quiet while an application may still send
+  Time start = Simulator::Now();
+  for (NodeList::Iterator node = NodeList::Begin(); node != NodeList::End();
+       ++node) {
+    for (uint32_t i = 0; i < (*node)->GetNApplications(); i++) {
+      TimeValue stopTime;
+      (*node)->GetApplication(i)->GetAttribute("StopTime", stopTime);
+      start = Max(start, stopTime.Get());
+    }
+  }
+  if (start < cap)
+    Simulator::Schedule(start - Simulator::Now(), &DrainDetector::Check,
+                        this);
+}
+
+bool DrainDetector::IsQuiet() const {
+  for (NodeList::Iterator node = NodeList::Begin(); node != NodeList::End();
+       ++node) {
+    Ptr<TrafficControlLayer> tc = (*node)->GetObject<TrafficControlLayer>();
+    for (uint32_t i = 0; i < (*node)->GetNDevices(); i++) {
+      Ptr<NetDevice> device = (*node)->GetDevice(i);
+      Ptr<PointToPointNetDevice> p2p =
+          DynamicCast<PointToPointNetDevice>(device);
+      if (p2p && !p2p->GetQueue()->IsEmpty())
+        return false;
+      Ptr<QueueDisc> qdisc = tc ? tc->GetRootQueueDiscOnDevice(device) : 0;
+      if (qdisc && qdisc->GetNPackets() > 0)
+        return false;
+    }
+
+    Ptr<TcpL4Protocol> tcp = (*node)->GetObject<TcpL4Protocol>();
+    if (!tcp)
+      continue;
+    ObjectVectorValue sockets;
+    tcp->GetAttribute("SocketList", sockets);
+    for (auto it = sockets.Begin(); it != sockets.End(); ++it) {
+      Ptr<TcpSocketBase> socket = DynamicCast<TcpSocketBase>(it->second);
+      if (socket && socket->GetTxBuffer()->Size() > 0)
+        return false;
+    }
+  }
+  return true;
+}
+
+void DrainDetector::Check() {
+  m_quietChecks = IsQuiet() ? m_quietChecks + 1 : 0;
+  if (m_quietChecks >= 2) {
+    m_drainTime = Simulator::Now().GetSeconds();
+    Simulator::Stop();
+    return;
+  }
+  if (Simulator::Now() + m_interval < m_cap)
+    Simulator::Schedule(m_interval, &DrainDetector::Check, this);
+}
+
+bool DrainDetector::IsDrained() const { return m_drainTime >= 0; }
+
+double DrainDetector::GetDrainTime() const { return m_drainTime; }
+
+double DrainDetector::GetSavedTime() const {
+  if (!IsDrained())
+    return 0.0;
+  return m_cap.GetSeconds() - m_drainTime;
+}
+
+void DrainDetector::WriteMetadata(std::ostream &out) const {
+  if (!IsDrained())
+    return;
+  out << "drain_time=" << m_drainTime << std::endl;
+  out << "drain_saved=" << GetSavedTime() << std::endl;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "ns3/core-module.h"
+
+#include <ostream>
+
+using namespace ns3;
+
+// Ends the simulation once the network has drained after the applications
+// stopped, instead of always running to the fixed stop time. From the
+// latest application StopTime on, it checks every `interval` that all
+// queue discs and point-to-point device queues are empty and that no TCP
+// socket has data in its send buffer. Two quiet checks in a row stop the
+// simulator, the second one covers packets that were on a link.
+class DrainDetector {
+public:
+  explicit DrainDetector(Time interval = MilliSeconds(50));
+
+  // Call after the applications are installed. `cap` is the stop time the
+  // simulation would run to otherwise, only used to report the saving.
+  void Schedule(Time cap);
+  void Reset();
+
+  bool IsDrained() const;
+  double GetDrainTime() const;
+  // Simulated seconds between the drain and `cap`
+  double GetSavedTime() const;
+
+  void WriteMetadata(std::ostream &out) const;
+
+private:
+  void Check();
+  bool IsQuiet() const;
+
+  Time m_interval;
+  Time m_cap;
+  uint32_t m_quietChecks;
+  double m_drainTime;
+};
@@ -1,3 +1,4 @@
+import os
 import utils
 import pandas
 from google_rate_est import get_first_and_last_loss_index, get_policing_rate
@@ -21,6 +22,7 @@ class ExperimentRun:
         self.client_pcap = client_pcap
         self.metadata_file = metadata_file
         self.params = params
+        self.estimates = {}
         self.metadata = self.get_metadata_info()
         self.estimation = estimation
         self.traffic_ratio = ratio
@@ -37,7 +39,17 @@ class ExperimentRun:
         
         self.pkt_filter = "tcp.srcport=={}".format(SERVER_PORT)
 
+    def has_event_logs(self):
+        return os.path.exists(utils.event_log_path(self.server_pcap)) and os.path.exists(utils.event_log_path(self.client_pcap))
+
     def get_pcap_df(self):
+        if self.has_event_logs():
+            self.pcap_df = utils.get_lossEvents_from_event_logs(
+                utils.event_log_path(self.server_pcap), utils.event_log_path(self.client_pcap), SERVER_PORT)
+            return self.pcap_df
+        self.pcap_df = utils.get_lossEvents_with_matcher(self.server_pcap, self.client_pcap, SERVER_PORT)
+        if self.pcap_df is not None:
+            return self.pcap_df
         self.pcap_df = utils.get_lossEvents_from_server_client_pcaps(
             self.server_pcap, self.client_pcap, SERVER_PORT)
         return self.pcap_df
@@ -48,11 +60,35 @@ class ExperimentRun:
         with open(self.metadata_file, 'r') as f:
             lines = f.readlines()
             metadata = [float(lines[0]), int(lines[1])]
+            # estimates computed online by the simulation, one key=value per line
+            for line in lines[2:]:
+                if '=' in line:
+                    key, value = line.strip().split('=', 1)
+                    try:
+                        self.estimates[key] = float(value)
+                    except ValueError:
+                        self.estimates[key] = value
             return metadata
+    
+    def get_stop_reason(self):
+        # why the simulation ended: "end", "converged", "no_drops"
+        return self.estimates.get('stop_reason', 'end')
+    
+    def native_rate_key(self):
+        return "{}_rate".format(RateEstimationMethod[self.estimation].value)
+
+    def has_native_estimate(self):
+        return self.estimation in RateEstimationMethod.__members__ and self.native_rate_key() in self.estimates
+
+    def has_native_google(self):
+        return 'google_rate' in self.estimates
         
     def get_estimated_rate(self):
         rate = 0.0
-        if self.estimation == RateEstimationMethod.TX_GAPS.name:
+        if self.has_native_estimate():
+            # computed online by the simulation, no need to read the pcaps
+            rate = self.estimates[self.native_rate_key()]
+        elif self.estimation == RateEstimationMethod.TX_GAPS.name:
             rate = compute_policing_rate_avg_tx(self.get_pcap_df())
         elif self.estimation == RateEstimationMethod.GOOGLE.name:
             if self.pcap_df is None:
@@ -72,6 +108,8 @@ class ExperimentRun:
         return rate
     
     def get_rtt_on_client(self):
+        if self.has_event_logs():
+            return utils.get_initial_rtt_from_event_log(utils.event_log_path(self.client_pcap))
         fields = {"tcp.analysis.initial_rtt": "rtt"}
         pkt_filter = "tcp.srcport=={}".format(CLIENT_PORT)
         client_df = utils.pcap_to_df(self.client_pcap, fields.keys(), pkt_filter=pkt_filter).rename(columns=fields)
@@ -81,6 +119,9 @@ class ExperimentRun:
         return rtt
     
     def get_client_df(self):
+        if self.has_event_logs():
+            self.client_df = utils.event_log_to_df(utils.event_log_path(self.client_pcap), srcport=SERVER_PORT)
+            return self.client_df
         self.client_df = utils.pcap_to_df(self.client_pcap, self.field.keys(), pkt_filter=self.pkt_filter).rename(columns=self.field)
         return self.client_df
         
@@ -131,7 +172,13 @@ def analyse_run(run: ExperimentRun):
     error_lost, error_lost_abs = 0, 0
     throughput = 2000000 # default value for throughput if no packets are received
     num_lost = 0
-    if run.estimation == RateEstimationMethod.GOOGLE.name:
+    if run.estimation == RateEstimationMethod.GOOGLE.name and run.has_native_google():
+        # the simulation already computed the estimate, the losses are the real drops
+        throughput = run.estimates['rx_rate']
+        num_lost = run.metadata[1]
+        if num_lost < 15:
+            return {"burst": run.params[0], "queue_size": run.params[1], "rate": 0, "lost": num_lost, "error_lost": 0, "error_lost_abs": 0, "error_rate": 1, "error_rate_abs": 1, "actual_rate": run.metadata[0], "rx_rate": throughput, "traffic_ratio": run.traffic_ratio}
+    elif run.estimation == RateEstimationMethod.GOOGLE.name:
         pcap_df = run.get_pcap_df()
         throughput = run.get_client_rx_throughput()
         print(f"Throughput at rx: {throughput}")
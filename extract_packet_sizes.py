@@ -1,4 +1,4 @@
-import types, sys, pickle, csv, pandas as pd #, ace_tools as tools
+import types, sys, pickle, csv, struct, pandas as pd #, ace_tools as tools
 
 # ------- Load pickle with dummy module for unknown classes -------
 class _Dummy:
@@ -48,6 +48,13 @@ with open(csv_path, "w", newline="") as f:
     for _, _, size in triples:
         writer.writerow([size])
 
+# ------- Same sizes in the binary form PacketSizeTable loads without parsing -------
+bin_path = "send_data/youtube_packets.bin"
+with open(bin_path, "wb") as f:
+    f.write(b"WEHESIZ\0")
+    f.write(struct.pack("<II", 1, len(triples)))
+    f.write(struct.pack("<{}I".format(len(triples)), *[size for _, _, size in triples]))
+
 # Show a preview (first 20 rows)
 df_preview = pd.read_csv(csv_path, nrows=20)
 # tools.display_dataframe_to_user(
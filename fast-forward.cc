@@ -0,0 +1,158 @@
+#include "fast-forward.h"
+
+#include <cmath>
+
+SawtoothFastForward::SawtoothFastForward(uint32_t stableCycles,
+                                         double tolerance)
+    : m_stableCycles(stableCycles < 2 ? 2 : stableCycles),
+      m_tolerance(tolerance) {
+  Reset();
+}
+
+void SawtoothFastForward::Reset() {
+  m_rtt = 0;
+  m_lastLoss = -1.0;
+  m_cycleStart = -1.0;
+  m_cycleBytes = 0;
+  m_current.clear();
+  m_last.clear();
+  m_cycles.clear();
+
+  m_forwardStart = -1.0;
+  m_forwardEnd = -1.0;
+  m_forwardedCycles = 0;
+  m_forwardedPackets = 0;
+  m_forwardedBytes = 0;
+  m_forwardedLosses = 0;
+}
+
+void SawtoothFastForward::Record(double time, EventType type, double value) {
+  // nothing before the first loss belongs to a cycle
+  if (m_cycleStart < 0)
+    return;
+  m_current.push_back({time - m_cycleStart, type, value});
+}
+
+void SawtoothFastForward::PacketDelivered(double time, uint32_t bytes) {
+  m_cycleBytes += bytes;
+  Record(time, DELIVERED, bytes);
+}
+
+bool SawtoothFastForward::PacketLost(double time) {
+  bool newEpisode = m_lastLoss < 0 || time - m_lastLoss > m_rtt;
+  m_lastLoss = time;
+  if (!newEpisode) {
+    Record(time, LOST, 0);
+    return false;
+  }
+
+  if (m_cycleStart >= 0) {
+    m_cycles.push_back({time - m_cycleStart, m_cycleBytes});
+    if (m_cycles.size() > m_stableCycles)
+      m_cycles.pop_front();
+    m_last.swap(m_current);
+  }
+  m_current.clear();
+  m_cycleStart = time;
+  m_cycleBytes = 0;
+  // always the first event of a cycle, FastForward relies on it
+  Record(time, LOST, 0);
+  return IsStable();
+}
+
+void SawtoothFastForward::CwndChanged(double time, uint32_t cwnd) {
+  Record(time, CWND, cwnd);
+}
+
+void SawtoothFastForward::RttChanged(double time, double rtt) {
+  m_rtt = rtt;
+  Record(time, RTT, rtt);
+}
+
+void SawtoothFastForward::RtoChanged(double time, double rto) {
+  Record(time, RTO, rto);
+}
+
+bool SawtoothFastForward::IsStable() const {
+  if (m_cycles.size() < m_stableCycles)
+    return false;
+
+  double duration = 0, bytes = 0;
+  for (const Cycle &cycle : m_cycles) {
+    duration += cycle.duration;
+    bytes += cycle.bytes;
+  }
+  duration /= m_cycles.size();
+  bytes /= m_cycles.size();
+  if (duration <= 0 || bytes <= 0)
+    return false;
+
+  for (const Cycle &cycle : m_cycles) {
+    if (std::fabs(cycle.duration - duration) > m_tolerance * duration ||
+        std::fabs(cycle.bytes - bytes) > m_tolerance * bytes)
+      return false;
+  }
+  return true;
+}
+
+void SawtoothFastForward::FastForward(double start, double end,
+                                      RateEstimators &estimators) {
+  m_forwardStart = start;
+  m_forwardEnd = end;
+  if (m_cycles.empty() || m_last.empty())
+    return;
+
+  double duration = m_cycles.back().duration;
+  // the loss that opens the first replayed cycle was already counted
+  size_t first = 1;
+  for (double base = start; base < end; base += duration, first = 0) {
+    m_forwardedCycles++;
+    for (size_t i = first; i < m_last.size(); i++) {
+      const Event &event = m_last[i];
+      double time = base + event.offset;
+      if (time >= end)
+        break;
+
+      switch (event.type) {
+      case DELIVERED:
+        estimators.PacketDelivered(time, event.value);
+        m_forwardedPackets++;
+        m_forwardedBytes += event.value;
+        break;
+      case LOST:
+        estimators.PacketLost(time);
+        m_forwardedLosses++;
+        break;
+      case CWND:
+        estimators.CwndChanged(time, event.value);
+        break;
+      case RTT:
+        estimators.RttChanged(time, event.value);
+        break;
+      case RTO:
+        estimators.RtoChanged(time, event.value);
+        break;
+      }
+    }
+  }
+}
+
+bool SawtoothFastForward::IsForwarded() const { return m_forwardStart >= 0; }
+
+uint64_t SawtoothFastForward::GetForwardedPackets() const {
+  return m_forwardedPackets;
+}
+
+uint64_t SawtoothFastForward::GetForwardedBytes() const {
+  return m_forwardedBytes;
+}
+
+void SawtoothFastForward::WriteMetadata(std::ostream &out) const {
+  if (!IsForwarded())
+    return;
+  out << "fast_forward_start=" << m_forwardStart << std::endl;
+  out << "fast_forward_end=" << m_forwardEnd << std::endl;
+  out << "fast_forward_cycles=" << m_forwardedCycles << std::endl;
+  out << "fast_forward_bytes=" << m_forwardedBytes << std::endl;
+  out << "fast_forward_losses=" << m_forwardedLosses << std::endl;
+}
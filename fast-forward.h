@@ -0,0 +1,79 @@
+#pragma once
+#include "rate-estimator.h"
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <vector>
+
+// Fast-forward over the steady state of a policed flow. The flow's events
+// are cut into cycles at the start of each loss episode (a loss more than
+// one RTT after the previous one). Once the last `stableCycles` cycles agree
+// in length and delivered bytes within `tolerance`, PacketLost returns true
+// and the caller can stop the packet-level simulation there.
+// FastForward then replays the events of the last cycle, shifted in time,
+// into the estimators until the end of the flow. That is cheaper than
+// simulating the same packets and keeps every estimator consistent.
+//
+// The replay only covers the counters fed through here. Pcaps, traces and
+// queue disc statistics end where the packet-level simulation stopped.
+class SawtoothFastForward {
+public:
+  explicit SawtoothFastForward(uint32_t stableCycles = 4,
+                               double tolerance = 0.05);
+
+  void Reset();
+
+  void PacketDelivered(double time, uint32_t bytes);
+  // True when the loss starts a new cycle and the sawtooth is stable
+  bool PacketLost(double time);
+  void CwndChanged(double time, uint32_t cwnd);
+  void RttChanged(double time, double rtt);
+  void RtoChanged(double time, double rto);
+
+  bool IsStable() const;
+
+  // Replays the last cycle into `estimators` from `start`, the loss for
+  // which PacketLost returned true and was already counted, until `end`
+  void FastForward(double start, double end, RateEstimators &estimators);
+
+  bool IsForwarded() const;
+  uint64_t GetForwardedPackets() const;
+  uint64_t GetForwardedBytes() const;
+
+  void WriteMetadata(std::ostream &out) const;
+
+private:
+  enum EventType : uint8_t { DELIVERED, LOST, CWND, RTT, RTO };
+
+  struct Event {
+    double offset; // seconds since the start of the cycle
+    EventType type;
+    double value;
+  };
+
+  struct Cycle {
+    double duration;
+    uint64_t bytes;
+  };
+
+  void Record(double time, EventType type, double value);
+
+  uint32_t m_stableCycles;
+  double m_tolerance;
+
+  double m_rtt;
+  double m_lastLoss;
+  double m_cycleStart;
+  uint64_t m_cycleBytes;
+  std::vector<Event> m_current; // events of the cycle in progress
+  std::vector<Event> m_last;    // events of the last complete cycle
+  std::deque<Cycle> m_cycles;
+
+  double m_forwardStart;
+  double m_forwardEnd;
+  uint32_t m_forwardedCycles;
+  uint64_t m_forwardedPackets;
+  uint64_t m_forwardedBytes;
+  uint64_t m_forwardedLosses;
+};
@@ -0,0 +1,98 @@
+#include "flow-table.h"
+
+#include <fstream>
+#include <stdexcept>
+
+FlowTable::FlowTable(uint32_t flows) { Resize(flows); }
+
+void FlowTable::Resize(uint32_t flows) {
+  m_bytes.assign(flows, 0);
+  m_packets.assign(flows, 0);
+  m_losses.assign(flows, 0);
+  m_firstRx.assign(flows, -1.0);
+  m_lastRx.assign(flows, -1.0);
+  m_firstLoss.assign(flows, -1.0);
+}
+
+void FlowTable::Reset() { Resize(GetFlowCount()); }
+
+uint32_t FlowTable::GetFlowCount() const { return m_bytes.size(); }
+
+void FlowTable::PacketDelivered(uint32_t flow, double time, uint32_t bytes) {
+  if (flow >= m_bytes.size())
+    return;
+  if (m_firstRx[flow] < 0)
+    m_firstRx[flow] = time;
+  m_lastRx[flow] = time;
+  m_bytes[flow] += bytes;
+  m_packets[flow]++;
+}
+
+void FlowTable::PacketLost(uint32_t flow, double time) {
+  if (flow >= m_losses.size())
+    return;
+  if (m_firstLoss[flow] < 0)
+    m_firstLoss[flow] = time;
+  m_losses[flow]++;
+}
+
+uint64_t FlowTable::GetDeliveredBytes(uint32_t flow) const {
+  return m_bytes[flow];
+}
+
+uint32_t FlowTable::GetLossCount(uint32_t flow) const {
+  return m_losses[flow];
+}
+
+double FlowTable::GetRate(uint32_t flow) const {
+  if (m_lastRx[flow] <= m_firstRx[flow])
+    return 0.0;
+  return m_bytes[flow] * 8 / (m_lastRx[flow] - m_firstRx[flow]);
+}
+
+uint64_t FlowTable::GetTotalBytes() const {
+  uint64_t total = 0;
+  for (uint64_t bytes : m_bytes)
+    total += bytes;
+  return total;
+}
+
+uint64_t FlowTable::GetTotalLosses() const {
+  uint64_t total = 0;
+  for (uint32_t losses : m_losses)
+    total += losses;
+  return total;
+}
+
+double FlowTable::GetFairness() const {
+  double sum = 0, squares = 0;
+  for (uint32_t flow = 0; flow < GetFlowCount(); flow++) {
+    double rate = GetRate(flow);
+    sum += rate;
+    squares += rate * rate;
+  }
+  if (squares == 0)
+    return 0.0;
+  return sum * sum / (GetFlowCount() * squares);
+}
+
+void FlowTable::WriteCsv(const std::string &filename) const {
+  std::ofstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Could not open file: " + filename);
+  }
+  file << "flow,rx_bytes,rx_packets,losses,first_rx,last_rx,first_loss,rate"
+       << std::endl;
+  for (uint32_t flow = 0; flow < GetFlowCount(); flow++) {
+    file << flow << "," << m_bytes[flow] << "," << m_packets[flow] << ","
+         << m_losses[flow] << "," << m_firstRx[flow] << "," << m_lastRx[flow]
+         << "," << m_firstLoss[flow] << "," << GetRate(flow) << "\n";
+  }
+}
+
+void FlowTable::WriteMetadata(std::ostream &out) const {
+  out << "flows=" << GetFlowCount() << std::endl;
+  out << "aggregate_rx_bytes=" << GetTotalBytes() << std::endl;
+  out << "aggregate_losses=" << GetTotalLosses() << std::endl;
+  out << "fairness=" << GetFairness() << std::endl;
+}
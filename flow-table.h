@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Per-flow counters of an aggregate, one flat column per counter indexed by
+// flow number. Updating a flow touches a few array slots, and the whole
+// table is written to one CSV at the end instead of a file per flow.
+class FlowTable {
+public:
+  explicit FlowTable(uint32_t flows = 0);
+
+  // Sets the number of flows and clears every counter
+  void Resize(uint32_t flows);
+  void Reset();
+
+  uint32_t GetFlowCount() const;
+
+  void PacketDelivered(uint32_t flow, double time, uint32_t bytes);
+  void PacketLost(uint32_t flow, double time);
+
+  uint64_t GetDeliveredBytes(uint32_t flow) const;
+  uint32_t GetLossCount(uint32_t flow) const;
+  // Delivered bits per second between the first and the last packet
+  double GetRate(uint32_t flow) const;
+
+  uint64_t GetTotalBytes() const;
+  uint64_t GetTotalLosses() const;
+  // Jain's fairness index of the per-flow rates, 1 when all are equal
+  double GetFairness() const;
+
+  // flow,rx_bytes,rx_packets,losses,first_rx,last_rx,first_loss,rate
+  void WriteCsv(const std::string &filename) const;
+  void WriteMetadata(std::ostream &out) const;
+
+private:
+  std::vector<uint64_t> m_bytes;
+  std::vector<uint32_t> m_packets;
+  std::vector<uint32_t> m_losses;
+  std::vector<double> m_firstRx;
+  std::vector<double> m_lastRx;
+  std::vector<double> m_firstLoss;
+};
@@ -8,6 +8,7 @@ import re
 from google_rate_est import *
 from explore_rate_est import *
 from experimentRun import *
+from result_store import ResultStore, STORE_FILE
 
 PCAP_FILE = '../../wehe-0-0.pcap'
 
@@ -72,7 +73,34 @@ def make_pattern(keyword):
     else:
         return re.compile(rf".*{re.escape(keyword)}.*")
 
+def get_experiment_runs_from_store(store, exp_name, estimation) -> list[ExperimentRun]:
+    # the simulations record NewReno as a parameter of the plain scenario
+    reno = exp_name.startswith(f"{EXP_RENO_ADDITION}-")
+    scenario = exp_name[len(EXP_RENO_ADDITION) + 1:] if reno else exp_name
+    runs = []
+    for record in store.find(scenario, reno=int(reno)):
+        burst = str(int(record["params"]["burst"]))
+        queue_size = record["params"]["queueSize"]
+        file_params = [burst, queue_size] + ([record["run_id"]] if record["run_id"] else [])
+        sim_file_start = store.local_path(record["files"]["sim"])
+        runs.append(ExperimentRun(
+            name=str.join('_', file_params),
+            server_pcap="".join([sim_file_start, SERVER_IDENTIFIER]),
+            client_pcap="".join([sim_file_start, CLIENT_IDENTIFIER]),
+            metadata_file=store.local_path(record["files"]["metadata"]),
+            params=file_params,
+            estimation=estimation,
+            ratio=record["params"].get("trafficRatio", 1.0)
+        ))
+    return runs
+
 def get_experiment_runs(exp_name, estimation = RateEstimationMethod.GOOGLE) -> list[ExperimentRun]:
+    if os.path.exists(os.path.join(DATA, STORE_FILE)):
+        return get_experiment_runs_from_store(ResultStore(DATA), exp_name, estimation)
+    # output from before the result store, `python result_store.py --import-legacy` adds it to the store
+    return get_experiment_runs_from_files(exp_name, estimation)
+
+def get_experiment_runs_from_files(exp_name, estimation) -> list[ExperimentRun]:
     files = [f for f in os.listdir(DATA) if os.path.isfile(os.path.join(DATA, f))]
     runs = []
     pat = make_pattern(exp_name)
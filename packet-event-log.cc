@@ -0,0 +1,103 @@
+#include "packet-event-log.h"
+
+#include "ns3/ipv4-header.h"
+#include "ns3/ppp-header.h"
+#include "ns3/simulator.h"
+#include "ns3/tcp-header.h"
+
+#include <cstring>
+#include <stdexcept>
+
+static const uint16_t PPP_IPV4 = 0x0021;
+static const uint8_t IP_PROTOCOL_TCP = 6;
+
+PacketEventLog::PacketEventLog(const std::string &filename,
+                               size_t bufferRecords)
+    : m_bufferRecords(bufferRecords), m_records(0) {
+  m_file.open(filename, std::ios::binary | std::ios::trunc);
+  if (!m_file.is_open()) {
+    throw std::runtime_error("Could not open event log " + filename);
+  }
+
+  PacketEventLogHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, "WEHEEVT", 7);
+  header.version = VERSION;
+  header.recordSize = sizeof(PacketEventRecord);
+  m_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  m_buffer.reserve(m_bufferRecords);
+}
+
+PacketEventLog::~PacketEventLog() { Close(); }
+
+void PacketEventLog::Attach(Ptr<NetDevice> device) {
+  device->TraceConnectWithoutContext(
+      "PromiscSniffer", MakeCallback(&PacketEventLog::Sniff, this));
+}
+
+void PacketEventLog::Sniff(Ptr<const Packet> packet) {
+  Ptr<Packet> copy = packet->Copy();
+
+  PppHeader ppp;
+  copy->RemoveHeader(ppp);
+  if (ppp.GetProtocol() != PPP_IPV4)
+    return;
+
+  Ipv4Header ip;
+  copy->RemoveHeader(ip);
+  if (ip.GetProtocol() != IP_PROTOCOL_TCP)
+    return;
+
+  TcpHeader tcp;
+  copy->RemoveHeader(tcp);
+
+  PacketEventRecord record;
+  record.timeNs = Simulator::Now().GetNanoSeconds();
+  record.flowId = static_cast<uint32_t>(tcp.GetSourcePort()) << 16 |
+                  tcp.GetDestinationPort();
+  record.seq = tcp.GetSequenceNumber().GetValue();
+  record.ipLength = ip.GetSerializedSize() + ip.GetPayloadSize();
+  record.tcpLength = copy->GetSize();
+  record.tcpFlags = tcp.GetFlags();
+  record.flags = 0;
+  record.reserved = 0;
+
+  if (record.tcpLength > 0) {
+    uint32_t end = record.seq + record.tcpLength;
+    auto next = m_nextSeq.find(record.flowId);
+    // compared as a difference so wrapped sequence numbers still order
+    if (next != m_nextSeq.end() &&
+        static_cast<int32_t>(end - next->second) <= 0) {
+      record.flags |= EVENT_RETRANSMISSION;
+    } else {
+      m_nextSeq[record.flowId] = end;
+    }
+  }
+
+  Append(record);
+}
+
+void PacketEventLog::Append(const PacketEventRecord &record) {
+  m_buffer.push_back(record);
+  m_records++;
+  if (m_buffer.size() >= m_bufferRecords)
+    Flush();
+}
+
+void PacketEventLog::Flush() {
+  if (m_buffer.empty() || !m_file.is_open())
+    return;
+  m_file.write(reinterpret_cast<const char *>(m_buffer.data()),
+               m_buffer.size() * sizeof(PacketEventRecord));
+  m_buffer.clear();
+}
+
+void PacketEventLog::Close() {
+  if (!m_file.is_open())
+    return;
+  Flush();
+  m_file.close();
+}
+
+uint64_t PacketEventLog::GetRecordCount() const { return m_records; }
@@ -0,0 +1,73 @@
+#pragma once
+#include "ns3/net-device.h"
+#include "ns3/packet.h"
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+// Header at the start of every event log, followed by the records. Fields
+// are in host byte order.
+struct PacketEventLogHeader {
+  char magic[8];       // "WEHEEVT"
+  uint32_t version;    // PacketEventLog::VERSION
+  uint32_t recordSize; // sizeof(PacketEventRecord)
+};
+
+// Bits of PacketEventRecord::flags
+enum PacketEventFlags : uint8_t {
+  // payload does not extend past the highest sequence number seen so far
+  // in the flow, close to tshark's tcp.analysis.retransmission
+  EVENT_RETRANSMISSION = 0x01,
+};
+
+// One TCP segment seen on a device: the fields the estimators take from the
+// pcaps, without the payload. 24 bytes, so a file can be mapped as an array.
+struct PacketEventRecord {
+  int64_t timeNs;     // simulation time
+  uint32_t flowId;    // tcp.srcport << 16 | tcp.dstport
+  uint32_t seq;       // raw tcp.seq
+  uint16_t ipLength;  // ip.len
+  uint16_t tcpLength; // tcp.len
+  uint8_t tcpFlags;
+  uint8_t flags; // PacketEventFlags
+  uint16_t reserved;
+};
+
+static_assert(sizeof(PacketEventRecord) == 24,
+              "event log records must stay 24 bytes");
+
+// Append-only writer of a binary event log. Records are collected in a
+// fixed buffer and written in blocks, so the simulation does no formatting
+// and only one write per `bufferRecords` packets.
+class PacketEventLog {
+public:
+  static const uint32_t VERSION = 1;
+
+  explicit PacketEventLog(const std::string &filename,
+                          size_t bufferRecords = 8192);
+  ~PacketEventLog();
+
+  // Records every TCP/IPv4 segment sent or received by a point-to-point
+  // device, the same packets a promiscuous pcap of it would contain
+  void Attach(Ptr<NetDevice> device);
+
+  void Append(const PacketEventRecord &record);
+  void Flush();
+  void Close();
+
+  uint64_t GetRecordCount() const;
+
+private:
+  void Sniff(Ptr<const Packet> packet);
+
+  std::ofstream m_file;
+  std::vector<PacketEventRecord> m_buffer;
+  size_t m_bufferRecords;
+  uint64_t m_records;
+  std::map<uint32_t, uint32_t> m_nextSeq; // highest seq + len per flow
+};
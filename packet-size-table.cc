@@ -0,0 +1,94 @@
+#include "packet-size-table.h"
+#include "utils.h"
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+static const char SIZE_TABLE_MAGIC[8] = "WEHESIZ";
+
+std::shared_ptr<const PacketSizeTable> PacketSizeTable::Load(
+    const std::string &filename) {
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<const PacketSizeTable>> cache;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto cached = cache.find(filename);
+  if (cached != cache.end())
+    return cached->second;
+
+  std::vector<uint32_t> sizes;
+  std::ifstream file(filename, std::ios::binary);
+  char magic[8] = {0};
+  file.read(magic, sizeof(magic));
+  if (file.gcount() == sizeof(magic) &&
+      std::memcmp(magic, SIZE_TABLE_MAGIC, sizeof(magic)) == 0) {
+    sizes = ReadBinary(filename);
+  } else {
+    sizes = readSizes(filename);
+  }
+  if (sizes.empty()) {
+    throw std::runtime_error("No packet sizes found in " + filename);
+  }
+
+  auto table = std::make_shared<const PacketSizeTable>(std::move(sizes));
+  cache[filename] = table;
+  return table;
+}
+
+PacketSizeTable::PacketSizeTable(std::vector<uint32_t> sizes)
+    : m_sizes(std::move(sizes)), m_alias(m_sizes) {}
+
+std::vector<uint32_t> PacketSizeTable::ReadBinary(const std::string &filename) {
+  std::ifstream file(filename, std::ios::binary);
+  char magic[8];
+  uint32_t version = 0, count = 0;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char *>(&version), sizeof(version));
+  file.read(reinterpret_cast<char *>(&count), sizeof(count));
+  if (!file || version != VERSION) {
+    throw std::runtime_error("Unsupported packet size file: " + filename);
+  }
+
+  std::vector<uint32_t> sizes(count);
+  file.read(reinterpret_cast<char *>(sizes.data()), count * sizeof(uint32_t));
+  if (!file) {
+    throw std::runtime_error("Truncated packet size file: " + filename);
+  }
+  return sizes;
+}
+
+void PacketSizeTable::WriteBinary(const std::string &filename) const {
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Could not open file: " + filename);
+  }
+  uint32_t version = VERSION;
+  uint32_t count = m_sizes.size();
+  file.write(SIZE_TABLE_MAGIC, sizeof(SIZE_TABLE_MAGIC));
+  file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+  file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  file.write(reinterpret_cast<const char *>(m_sizes.data()),
+             count * sizeof(uint32_t));
+}
+
+size_t PacketSizeTable::GetSize() const { return m_sizes.size(); }
+
+uint32_t PacketSizeTable::Get(size_t index) const { return m_sizes[index]; }
+
+uint32_t PacketSizeTable::Draw(double u1, double u2) const {
+  return m_alias.Draw(u1, u2);
+}
+
+PacketSizeSampler::PacketSizeSampler(
+    std::shared_ptr<const PacketSizeTable> table, Mode mode,
+    Ptr<UniformRandomVariable> random)
+    : m_table(table), m_mode(mode), m_random(random), m_index(0) {}
+
+uint32_t PacketSizeSampler::Next() {
+  if (m_mode == IID)
+    return m_table->Draw(m_random->GetValue(), m_random->GetValue());
+  return m_table->Get(m_index++ % m_table->GetSize());
+}
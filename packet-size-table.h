@@ -0,0 +1,59 @@
+#pragma once
+#include "ns3/random-variable-stream.h"
+
+#include "alias-table.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+// Immutable list of packet sizes from a trace, loaded once per process and
+// shared by every sender that uses the same file. The file is either the
+// CSV written by extract_packet_sizes.py (header line, one size per line)
+// or the binary form: "WEHESIZ\0", uint32 version, uint32 count, sizes.
+class PacketSizeTable {
+public:
+  static const uint32_t VERSION = 1;
+
+  // Returns the cached table of `filename`, loading it on first use
+  static std::shared_ptr<const PacketSizeTable> Load(
+      const std::string &filename);
+
+  explicit PacketSizeTable(std::vector<uint32_t> sizes);
+
+  size_t GetSize() const;
+  uint32_t Get(size_t index) const;
+
+  // i.i.d. draw from the empirical distribution, see AliasTable. u1 and u2
+  // in [0, 1).
+  uint32_t Draw(double u1, double u2) const;
+
+  void WriteBinary(const std::string &filename) const;
+
+private:
+  static std::vector<uint32_t> ReadBinary(const std::string &filename);
+
+  std::vector<uint32_t> m_sizes;
+  AliasTable m_alias; // over the distinct sizes, built from m_sizes
+};
+
+// Produces the sizes of consecutive sends from a shared table, either by
+// replaying the trace in order or by drawing from its distribution.
+class PacketSizeSampler {
+public:
+  enum Mode { SEQUENTIAL, IID };
+
+  PacketSizeSampler(std::shared_ptr<const PacketSizeTable> table, Mode mode,
+                    Ptr<UniformRandomVariable> random);
+
+  uint32_t Next();
+
+private:
+  std::shared_ptr<const PacketSizeTable> m_table;
+  Mode m_mode;
+  Ptr<UniformRandomVariable> m_random;
+  uint64_t m_index;
+};
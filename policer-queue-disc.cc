@@ -0,0 +1,211 @@
+#include "policer-queue-disc.h"
+#include "ns3/boolean.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("PolicerQueueDisc");
+
+NS_OBJECT_ENSURE_REGISTERED(PolicerQueueDisc);
+
+TypeId PolicerQueueDisc::GetTypeId(void) {
+  static TypeId tid =
+      TypeId("ns3::PolicerQueueDisc")
+          .SetParent<QueueDisc>()
+          .SetGroupName("TrafficControl")
+          .AddConstructor<PolicerQueueDisc>()
+          .AddAttribute("MaxSize",
+                        "Size of the shaping queue, unused without Shaping",
+                        QueueSizeValue(QueueSize("1000p")),
+                        MakeQueueSizeAccessor(&QueueDisc::SetMaxSize,
+                                              &QueueDisc::GetMaxSize),
+                        MakeQueueSizeChecker())
+          .AddAttribute("Burst", "Size of the first bucket in bytes",
+                        UintegerValue(125000),
+                        MakeUintegerAccessor(&PolicerQueueDisc::m_burst),
+                        MakeUintegerChecker<uint32_t>())
+          .AddAttribute("Mtu", "Size of the second bucket in bytes",
+                        UintegerValue(0),
+                        MakeUintegerAccessor(&PolicerQueueDisc::m_mtu),
+                        MakeUintegerChecker<uint32_t>())
+          .AddAttribute("Rate", "Rate of tokens arriving in the first bucket",
+                        DataRateValue(DataRate("125KB/s")),
+                        MakeDataRateAccessor(&PolicerQueueDisc::m_rate),
+                        MakeDataRateChecker())
+          .AddAttribute("PeakRate",
+                        "Rate of tokens arriving in the second bucket, zero "
+                        "disables it",
+                        DataRateValue(DataRate("0bps")),
+                        MakeDataRateAccessor(&PolicerQueueDisc::m_peakRate),
+                        MakeDataRateChecker())
+          .AddAttribute("Shaping",
+                        "Queue packets that do not conform instead of "
+                        "dropping them on arrival",
+                        BooleanValue(true),
+                        MakeBooleanAccessor(&PolicerQueueDisc::m_shaping),
+                        MakeBooleanChecker())
+          .AddAttribute("TokenTraceInterval",
+                        "Minimum time between two TokensSample reports",
+                        TimeValue(MilliSeconds(1)),
+                        MakeTimeAccessor(&PolicerQueueDisc::m_traceInterval),
+                        MakeTimeChecker())
+          .AddTraceSource("TokensSample",
+                          "Tokens in the first bucket, sampled at packet "
+                          "arrivals at most once per TokenTraceInterval",
+                          MakeTraceSourceAccessor(
+                              &PolicerQueueDisc::m_tokenTrace),
+                          "ns3::PolicerQueueDisc::TokensTracedCallback");
+  return tid;
+}
+
+PolicerQueueDisc::PolicerQueueDisc()
+    : QueueDisc(QueueDiscSizePolicy::SINGLE_INTERNAL_QUEUE), m_tokens(0),
+      m_peakTokens(0) {}
+
+PolicerQueueDisc::~PolicerQueueDisc() {}
+
+void PolicerQueueDisc::DoDispose(void) {
+  Simulator::Cancel(m_wakeEvent);
+  QueueDisc::DoDispose();
+}
+
+double PolicerQueueDisc::GetFirstBucketTokens() {
+  Refill();
+  return m_tokens;
+}
+
+double PolicerQueueDisc::GetSecondBucketTokens() {
+  Refill();
+  return m_peakTokens;
+}
+
+void PolicerQueueDisc::Refill(void) {
+  Time now = Simulator::Now();
+  double elapsed = std::max(0.0, (now - m_lastRefill).GetSeconds());
+  m_lastRefill = now;
+
+  // clamped even without new tokens, so a smaller Burst or Mtu applies at once
+  m_tokens = std::min<double>(m_burst,
+                              m_tokens + m_rate.GetBitRate() / 8.0 * elapsed);
+  if (m_peakRate.GetBitRate() > 0) {
+    m_peakTokens = std::min<double>(
+        m_mtu, m_peakTokens + m_peakRate.GetBitRate() / 8.0 * elapsed);
+  }
+}
+
+bool PolicerQueueDisc::Conforms(uint32_t size) const {
+  return m_tokens >= size &&
+         (m_peakRate.GetBitRate() == 0 || m_peakTokens >= size);
+}
+
+void PolicerQueueDisc::Consume(uint32_t size) {
+  m_tokens -= size;
+  if (m_peakRate.GetBitRate() > 0)
+    m_peakTokens -= size;
+}
+
+Time PolicerQueueDisc::TimeToConform(uint32_t size) const {
+  double wait = std::max(0.0, (size - m_tokens) * 8.0 / m_rate.GetBitRate());
+  if (m_peakRate.GetBitRate() > 0) {
+    wait = std::max(wait,
+                    (size - m_peakTokens) * 8.0 / m_peakRate.GetBitRate());
+  }
+  // rounded up, so that the wake-up never comes before the tokens
+  return NanoSeconds(std::max<int64_t>(1, std::ceil(wait * 1e9)));
+}
+
+void PolicerQueueDisc::SampleTokens(void) {
+  Time now = Simulator::Now();
+  if (m_tokenTrace.IsEmpty() || now - m_lastSample < m_traceInterval)
+    return;
+  m_lastSample = now;
+  m_tokenTrace(now, m_tokens);
+}
+
+bool PolicerQueueDisc::DoEnqueue(Ptr<QueueDiscItem> item) {
+  NS_LOG_FUNCTION(this << item);
+
+  Refill();
+  SampleTokens();
+
+  if (!m_shaping) {
+    // Pure policer: the packet either conforms now or is dropped
+    if (!Conforms(item->GetSize())) {
+      DropBeforeEnqueue(item, "Out of profile");
+      return false;
+    }
+    Consume(item->GetSize());
+  } else if (GetCurrentSize() + item > GetMaxSize()) {
+    DropBeforeEnqueue(item, LIMIT_EXCEEDED_DROP);
+    return false;
+  }
+
+  return GetInternalQueue(0)->Enqueue(item);
+}
+
+Ptr<const QueueDiscItem> PolicerQueueDisc::DoPeek(void) {
+  return GetInternalQueue(0)->Peek();
+}
+
+Ptr<QueueDiscItem> PolicerQueueDisc::DoDequeue(void) {
+  NS_LOG_FUNCTION(this);
+
+  Ptr<const QueueDiscItem> head = GetInternalQueue(0)->Peek();
+  if (!head)
+    return 0;
+
+  if (m_shaping) {
+    Refill();
+    uint32_t size = head->GetSize();
+    if (!Conforms(size)) {
+      // one wake-up for when the head packet conforms, none while idle
+      if (!m_wakeEvent.IsRunning()) {
+        m_wakeEvent =
+            Simulator::Schedule(TimeToConform(size), &QueueDisc::Run, this);
+      }
+      return 0;
+    }
+    Consume(size);
+  }
+
+  return GetInternalQueue(0)->Dequeue();
+}
+
+bool PolicerQueueDisc::CheckConfig(void) {
+  if (GetNQueueDiscClasses() > 0 || GetNPacketFilters() > 0) {
+    NS_LOG_ERROR("PolicerQueueDisc cannot have classes or packet filters");
+    return false;
+  }
+  if (m_burst == 0 || m_rate.GetBitRate() == 0) {
+    NS_LOG_ERROR("Burst and Rate must be greater than zero");
+    return false;
+  }
+  if (m_peakRate.GetBitRate() > 0 &&
+      (m_mtu == 0 || m_peakRate <= m_rate)) {
+    NS_LOG_ERROR("A second bucket needs an Mtu and a PeakRate above Rate");
+    return false;
+  }
+
+  if (GetNInternalQueues() == 0) {
+    AddInternalQueue(
+        CreateObjectWithAttributes<DropTailQueue<QueueDiscItem>>(
+            "MaxSize", QueueSizeValue(GetMaxSize())));
+  }
+  return GetNInternalQueues() == 1;
+}
+
+void PolicerQueueDisc::InitializeParams(void) {
+  // both buckets start full, as in TBF
+  m_tokens = m_burst;
+  m_peakTokens = m_mtu;
+  m_lastRefill = Simulator::Now();
+  m_lastSample = Seconds(-1);
+}
+
+} // namespace ns3
@@ -0,0 +1,65 @@
+#pragma once
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/queue-disc.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+// Token bucket policer with the attributes of TbfQueueDisc (MaxSize, Burst,
+// Mtu, Rate, PeakRate), so it can replace it in any scenario.
+//
+// Tokens are refilled lazily from the time since the last update, only
+// when a packet arrives or leaves, so an idle policer costs no events.
+// Without Shaping a packet that does not conform is dropped on arrival;
+// with Shaping it waits in a queue of MaxSize like in TBF, and a single
+// event is scheduled for when the head packet will conform.
+//
+// TokensSample reports the first bucket at most once per
+// TokenTraceInterval, which keeps it cheap enough to leave on.
+class PolicerQueueDisc : public QueueDisc {
+public:
+  static TypeId GetTypeId(void);
+
+  // Signature of the TokensSample trace: time and first bucket tokens
+  typedef void (*TokensTracedCallback)(Time time, double tokens);
+
+  PolicerQueueDisc();
+  virtual ~PolicerQueueDisc();
+
+  // Token counts in bytes, refilled up to now
+  double GetFirstBucketTokens();
+  double GetSecondBucketTokens();
+
+private:
+  virtual bool DoEnqueue(Ptr<QueueDiscItem> item);
+  virtual Ptr<QueueDiscItem> DoDequeue(void);
+  virtual Ptr<const QueueDiscItem> DoPeek(void);
+  virtual bool CheckConfig(void);
+  virtual void InitializeParams(void);
+  virtual void DoDispose(void);
+
+  void Refill(void);
+  bool Conforms(uint32_t size) const;
+  void Consume(uint32_t size);
+  Time TimeToConform(uint32_t size) const;
+  void SampleTokens(void);
+
+  uint32_t m_burst;
+  uint32_t m_mtu;
+  DataRate m_rate;
+  DataRate m_peakRate;
+  bool m_shaping;
+  Time m_traceInterval;
+
+  double m_tokens;     // first bucket, bytes
+  double m_peakTokens; // second bucket, bytes
+  Time m_lastRefill;
+  Time m_lastSample;
+  EventId m_wakeEvent;
+
+  TracedCallback<Time, double> m_tokenTrace;
+};
+
+} // namespace ns3
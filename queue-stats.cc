@@ -0,0 +1,136 @@
+#include "queue-stats.h"
+
+#include "ns3/simulator.h"
+
+#include <algorithm>
+
+// Used to bound the occupancy in one unit by a MaxSize given in the other
+static const uint32_t MIN_PACKET_BYTES = 40; // IPv4 + TCP headers
+static const uint32_t MAX_PACKET_BYTES = 1500;
+
+QueueOccupancyStats::QueueOccupancyStats(uint32_t bins)
+    : m_bins(bins), m_unit("packets") {
+  SetRange(bins - 1);
+  Reset();
+}
+
+void QueueOccupancyStats::Attach(Ptr<QueueDisc> queue, QueueSizeUnit unit) {
+  QueueSize maxSize = queue->GetMaxSize();
+  uint32_t maxValue = maxSize.GetValue();
+  if (maxSize.GetUnit() == QueueSizeUnit::BYTES &&
+      unit == QueueSizeUnit::PACKETS)
+    maxValue /= MIN_PACKET_BYTES;
+  else if (maxSize.GetUnit() == QueueSizeUnit::PACKETS &&
+           unit == QueueSizeUnit::BYTES)
+    maxValue *= MAX_PACKET_BYTES;
+  SetRange(maxValue);
+
+  if (unit == QueueSizeUnit::PACKETS) {
+    m_unit = "packets";
+    queue->TraceConnectWithoutContext(
+        "PacketsInQueue", MakeCallback(&QueueOccupancyStats::Trace, this));
+  } else {
+    m_unit = "bytes";
+    queue->TraceConnectWithoutContext(
+        "BytesInQueue", MakeCallback(&QueueOccupancyStats::Trace, this));
+  }
+}
+
+void QueueOccupancyStats::SetRange(uint32_t maxValue) {
+  m_binWidth = std::max<uint32_t>(1, maxValue / m_bins + 1);
+  m_histogram.assign(m_bins, 0.0);
+}
+
+void QueueOccupancyStats::Reset() {
+  std::fill(m_histogram.begin(), m_histogram.end(), 0.0);
+  m_start = -1.0;
+  m_lastTime = 0.0;
+  m_lastValue = 0;
+  m_weightedSum = 0.0;
+  m_eventSum = 0.0;
+  m_events = 0;
+  m_max = 0;
+}
+
+void QueueOccupancyStats::Trace(uint32_t oldValue, uint32_t newValue) {
+  Update(Simulator::Now().GetSeconds(), newValue);
+}
+
+void QueueOccupancyStats::Update(double time, uint32_t value) {
+  if (m_start < 0) {
+    // the queue is empty until its first change
+    m_start = 0.0;
+    m_lastTime = 0.0;
+  }
+  Finish(time);
+  m_lastValue = value;
+  m_eventSum += value;
+  m_events++;
+  m_max = std::max(m_max, value);
+}
+
+void QueueOccupancyStats::Finish(double time) {
+  if (m_start < 0 || time <= m_lastTime)
+    return;
+  double duration = time - m_lastTime;
+  uint32_t bin = std::min(m_lastValue / m_binWidth, m_bins - 1);
+  m_histogram[bin] += duration;
+  m_weightedSum += duration * m_lastValue;
+  m_lastTime = time;
+}
+
+uint64_t QueueOccupancyStats::GetEventCount() const { return m_events; }
+
+double QueueOccupancyStats::GetEventMean() const {
+  if (m_events == 0)
+    return 0.0;
+  return m_eventSum / m_events;
+}
+
+double QueueOccupancyStats::GetTimeMean() const {
+  if (m_lastTime <= m_start)
+    return 0.0;
+  return m_weightedSum / (m_lastTime - m_start);
+}
+
+uint32_t QueueOccupancyStats::GetMax() const { return m_max; }
+
+double QueueOccupancyStats::GetPercentile(double percentile) const {
+  double total = m_lastTime - m_start;
+  if (m_start < 0 || total <= 0)
+    return 0.0;
+
+  double target = total * percentile / 100.0;
+  double cumulative = 0.0;
+  for (uint32_t bin = 0; bin < m_bins; bin++) {
+    if (m_histogram[bin] <= 0)
+      continue;
+    if (cumulative + m_histogram[bin] >= target) {
+      if (m_binWidth == 1)
+        return bin;
+      // spread the time evenly over the values of the bin
+      double fraction = (target - cumulative) / m_histogram[bin];
+      return std::min<double>(bin * m_binWidth + fraction * m_binWidth,
+                              m_max);
+    }
+    cumulative += m_histogram[bin];
+  }
+  return m_max;
+}
+
+void QueueOccupancyStats::Print(std::ostream &out) const {
+  out << "Time-weighted average (" << m_unit << "): " << GetTimeMean()
+      << std::endl;
+  out << "Maximum (" << m_unit << "): " << m_max << std::endl;
+  out << "Percentiles p50/p90/p99 (" << m_unit << "): " << GetPercentile(50)
+      << "/" << GetPercentile(90) << "/" << GetPercentile(99) << std::endl;
+}
+
+void QueueOccupancyStats::WriteMetadata(std::ostream &out,
+                                        const std::string &prefix) const {
+  out << prefix << "_mean=" << GetTimeMean() << std::endl;
+  out << prefix << "_max=" << m_max << std::endl;
+  out << prefix << "_p50=" << GetPercentile(50) << std::endl;
+  out << prefix << "_p90=" << GetPercentile(90) << std::endl;
+  out << prefix << "_p99=" << GetPercentile(99) << std::endl;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "ns3/queue-disc.h"
+#include "ns3/queue-size.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+// Occupancy statistics of a queue in constant memory: a fixed histogram of
+// the time spent at each occupancy, plus the time-weighted mean, the mean
+// over trace events and the maximum. Percentiles are read from the
+// histogram, exact while a bin covers a single value.
+class QueueOccupancyStats {
+public:
+  explicit QueueOccupancyStats(uint32_t bins = 512);
+
+  // Follows the PacketsInQueue or BytesInQueue trace of `queue`. The
+  // histogram covers the queue's MaxSize converted to `unit`; anything
+  // above lands in the last bin but still counts towards mean and max.
+  void Attach(Ptr<QueueDisc> queue, QueueSizeUnit unit);
+
+  void Reset();
+
+  void Update(double time, uint32_t value);
+
+  // Closes the interval of the current occupancy, call before reading
+  void Finish(double time);
+
+  uint64_t GetEventCount() const;
+  double GetEventMean() const;
+  double GetTimeMean() const;
+  uint32_t GetMax() const;
+  double GetPercentile(double percentile) const;
+
+  void Print(std::ostream &out) const;
+  void WriteMetadata(std::ostream &out, const std::string &prefix) const;
+
+private:
+  void Trace(uint32_t oldValue, uint32_t newValue);
+  void SetRange(uint32_t maxValue);
+
+  uint32_t m_bins;
+  uint32_t m_binWidth;
+  std::vector<double> m_histogram; // seconds spent per bin
+  std::string m_unit;
+
+  double m_start;
+  double m_lastTime;
+  uint32_t m_lastValue;
+  double m_weightedSum; // integral of occupancy over time
+  double m_eventSum;
+  uint64_t m_events;
+  uint32_t m_max;
+};
@@ -0,0 +1,397 @@
+#include "rate-estimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+StreamingQuantile::StreamingQuantile(double quantile) : m_quantile(quantile) {
+  Reset();
+}
+
+void StreamingQuantile::Reset() {
+  m_count = 0;
+  for (int i = 0; i < 5; i++) {
+    m_heights[i] = 0.0;
+    m_positions[i] = i;
+  }
+  m_desired[0] = 0;
+  m_desired[1] = 2 * m_quantile;
+  m_desired[2] = 4 * m_quantile;
+  m_desired[3] = 2 + 2 * m_quantile;
+  m_desired[4] = 4;
+  m_increment[0] = 0;
+  m_increment[1] = m_quantile / 2;
+  m_increment[2] = m_quantile;
+  m_increment[3] = (1 + m_quantile) / 2;
+  m_increment[4] = 1;
+}
+
+void StreamingQuantile::Add(double value) {
+  if (m_count < 5) {
+    m_heights[m_count++] = value;
+    if (m_count == 5)
+      std::sort(m_heights, m_heights + 5);
+    return;
+  }
+
+  int k;
+  if (value < m_heights[0]) {
+    m_heights[0] = value;
+    k = 0;
+  } else if (value >= m_heights[4]) {
+    m_heights[4] = value;
+    k = 3;
+  } else {
+    k = 0;
+    while (value >= m_heights[k + 1])
+      k++;
+  }
+
+  for (int i = k + 1; i < 5; i++)
+    m_positions[i]++;
+  for (int i = 0; i < 5; i++)
+    m_desired[i] += m_increment[i];
+  m_count++;
+
+  // move the middle markers towards their desired positions
+  for (int i = 1; i < 4; i++) {
+    double d = m_desired[i] - m_positions[i];
+    if ((d >= 1 && m_positions[i + 1] - m_positions[i] > 1) ||
+        (d <= -1 && m_positions[i - 1] - m_positions[i] < -1)) {
+      int step = d > 0 ? 1 : -1;
+      double height = Parabolic(i, step);
+      if (m_heights[i - 1] < height && height < m_heights[i + 1])
+        m_heights[i] = height;
+      else
+        m_heights[i] = Linear(i, step);
+      m_positions[i] += step;
+    }
+  }
+}
+
+double StreamingQuantile::Parabolic(int i, double d) const {
+  return m_heights[i] +
+         d / (m_positions[i + 1] - m_positions[i - 1]) *
+             ((m_positions[i] - m_positions[i - 1] + d) *
+                  (m_heights[i + 1] - m_heights[i]) /
+                  (m_positions[i + 1] - m_positions[i]) +
+              (m_positions[i + 1] - m_positions[i] - d) *
+                  (m_heights[i] - m_heights[i - 1]) /
+                  (m_positions[i] - m_positions[i - 1]));
+}
+
+double StreamingQuantile::Linear(int i, int d) const {
+  return m_heights[i] + d * (m_heights[i + d] - m_heights[i]) /
+                            (m_positions[i + d] - m_positions[i]);
+}
+
+double StreamingQuantile::Get() const {
+  if (m_count == 0)
+    return 0.0;
+  if (m_count < 5) {
+    // too few samples for the markers, interpolate like numpy does
+    double sorted[5];
+    std::copy(m_heights, m_heights + m_count, sorted);
+    std::sort(sorted, sorted + m_count);
+    double rank = m_quantile * (m_count - 1);
+    size_t lower = static_cast<size_t>(rank);
+    size_t upper = std::min<size_t>(lower + 1, m_count - 1);
+    return sorted[lower] + (rank - lower) * (sorted[upper] - sorted[lower]);
+  }
+  return m_heights[2];
+}
+
+uint64_t StreamingQuantile::GetCount() const { return m_count; }
+
+void RateEstimator::WriteMetadata(std::ostream &out) const {
+  out << GetName() << "_rate=" << GetRate() << std::endl;
+}
+
+GoogleRateEstimator::GoogleRateEstimator() { Reset(); }
+
+std::string GoogleRateEstimator::GetName() const { return "google"; }
+
+void GoogleRateEstimator::Reset() {
+  m_firstLoss = -1.0;
+  m_lastLoss = -1.0;
+  m_bytesSinceFirstLoss = 0;
+  m_bytesAtLastLoss = 0;
+  m_losses = 0;
+
+  m_firstRx = -1.0;
+  m_lastRx = -1.0;
+  m_rxBytes = 0;
+}
+
+void GoogleRateEstimator::PacketDelivered(double time, uint32_t bytes) {
+  if (m_firstRx < 0)
+    m_firstRx = time;
+  m_lastRx = time;
+  m_rxBytes += bytes;
+
+  if (m_firstLoss > 0)
+    m_bytesSinceFirstLoss += bytes;
+}
+
+void GoogleRateEstimator::PacketLost(double time) {
+  if (m_firstLoss < 0)
+    m_firstLoss = time;
+  m_lastLoss = time;
+  // bytes delivered after the last loss are not part of the estimate, so
+  // only the running sum at the latest loss is kept
+  m_bytesAtLastLoss = m_bytesSinceFirstLoss;
+  m_losses++;
+}
+
+bool GoogleRateEstimator::HasEstimate() const {
+  return m_losses > 1 && m_lastLoss > m_firstLoss;
+}
+
+double GoogleRateEstimator::GetRate() const {
+  if (!HasEstimate())
+    return 0.0;
+  return m_bytesAtLastLoss / (m_lastLoss - m_firstLoss) * 8;
+}
+
+double GoogleRateEstimator::GetFirstLossTime() const { return m_firstLoss; }
+
+double GoogleRateEstimator::GetLastLossTime() const { return m_lastLoss; }
+
+uint64_t GoogleRateEstimator::GetDeliveredBytes() const {
+  return m_bytesAtLastLoss;
+}
+
+uint32_t GoogleRateEstimator::GetLossCount() const { return m_losses; }
+
+double GoogleRateEstimator::GetRxRate() const {
+  if (m_lastRx <= m_firstRx)
+    return 0.0;
+  return m_rxBytes / (m_lastRx - m_firstRx) * 8;
+}
+
+void GoogleRateEstimator::WriteMetadata(std::ostream &out) const {
+  out << "google_rate=" << GetRate() << std::endl;
+  out << "google_first_loss=" << m_firstLoss << std::endl;
+  out << "google_last_loss=" << m_lastLoss << std::endl;
+  out << "google_delivered_bytes=" << m_bytesAtLastLoss << std::endl;
+  out << "rx_rate=" << GetRxRate() << std::endl;
+}
+
+TxGapsRateEstimator::TxGapsRateEstimator() { Reset(); }
+
+std::string TxGapsRateEstimator::GetName() const { return "tx_gaps"; }
+
+void TxGapsRateEstimator::Reset() {
+  m_lastLoss = 0.0;
+  m_lastPacket = 0.0;
+  m_gapBytes = 0;
+  m_sumGapRates = 0.0;
+  m_gaps = 0;
+}
+
+void TxGapsRateEstimator::PacketDelivered(double time, uint32_t bytes) {
+  m_lastPacket = time;
+  m_gapBytes += bytes;
+}
+
+void TxGapsRateEstimator::PacketLost(double time) {
+  if (time > m_lastLoss) {
+    m_sumGapRates += m_gapBytes / (time - m_lastLoss);
+    m_gaps++;
+  }
+  m_lastLoss = time;
+  m_lastPacket = std::max(m_lastPacket, time);
+  m_gapBytes = 0;
+}
+
+double TxGapsRateEstimator::GetRate() const {
+  double sum = m_sumGapRates;
+  uint32_t gaps = m_gaps;
+  // the gap after the last loss is still open
+  if (m_lastPacket > m_lastLoss) {
+    sum += m_gapBytes / (m_lastPacket - m_lastLoss);
+    gaps++;
+  }
+  if (gaps == 0)
+    return 0.0;
+  return sum / gaps * 8;
+}
+
+TxSampleRateEstimator::TxSampleRateEstimator(double sampleTime)
+    : m_configuredSampleTime(sampleTime) {
+  Reset();
+}
+
+std::string TxSampleRateEstimator::GetName() const { return "tx_sample"; }
+
+void TxSampleRateEstimator::Reset() {
+  m_sampleTime = m_configuredSampleTime;
+  m_binEnd = m_sampleTime;
+  m_binBytes = 0;
+  m_median.Reset();
+}
+
+void TxSampleRateEstimator::RttChanged(double time, double rtt) {
+  if (m_sampleTime <= 0 && rtt > 0) {
+    m_sampleTime = rtt;
+    m_binEnd = rtt;
+  }
+}
+
+void TxSampleRateEstimator::PacketDelivered(double time, uint32_t bytes) {
+  // until the first RTT sample everything counts towards the first bin
+  if (m_sampleTime > 0 && time >= m_binEnd) {
+    // one bin further however late the packet is, as in the pcap version
+    m_median.Add(m_binBytes / m_sampleTime);
+    m_binEnd += m_sampleTime;
+    m_binBytes = 0;
+  }
+  m_binBytes += bytes;
+}
+
+double TxSampleRateEstimator::GetRate() const {
+  if (m_sampleTime <= 0)
+    return 0.0;
+  // include the bin that is still open without disturbing the sketch
+  StreamingQuantile median = m_median;
+  median.Add(m_binBytes / m_sampleTime);
+  return median.Get() * 8;
+}
+
+CumulativeRateEstimator::CumulativeRateEstimator(double minGap)
+    : m_minGap(minGap) {
+  Reset();
+}
+
+std::string CumulativeRateEstimator::GetName() const { return "cumulative"; }
+
+void CumulativeRateEstimator::Reset() {
+  m_lastPacket = -1.0;
+  m_median.Reset();
+}
+
+void CumulativeRateEstimator::PacketDelivered(double time, uint32_t bytes) {
+  if (m_lastPacket < 0) {
+    // no gap before the first packet, pandas gives it a rate of 0
+    if (m_minGap <= 0)
+      m_median.Add(0.0);
+  } else {
+    double gap = time - m_lastPacket;
+    // an infinite rate in pandas, see the header
+    if (gap > 0 && gap >= m_minGap)
+      m_median.Add(bytes / gap);
+  }
+  m_lastPacket = time;
+}
+
+double CumulativeRateEstimator::GetRate() const { return m_median.Get() * 8; }
+
+CwndRateEstimator::CwndRateEstimator(double timeBarrier)
+    : m_timeBarrier(timeBarrier) {
+  Reset();
+}
+
+std::string CwndRateEstimator::GetName() const { return "cwnd"; }
+
+void CwndRateEstimator::Reset() {
+  m_delay = 0.0;
+  m_delayTime = 0.0;
+  m_pending.clear();
+  m_sumRates = 0.0;
+  m_samples = 0;
+}
+
+void CwndRateEstimator::AddSample(uint32_t cwnd, double delay) {
+  if (delay <= 0)
+    return;
+  m_sumRates += cwnd / delay;
+  m_samples++;
+}
+
+void CwndRateEstimator::CwndChanged(double time, uint32_t cwnd) {
+  if (time <= m_timeBarrier)
+    return;
+  m_pending.emplace_back(time, cwnd);
+}
+
+void CwndRateEstimator::DelayChanged(double time, double delay) {
+  for (const auto &sample : m_pending) {
+    bool previous =
+        m_delay > 0 && sample.first - m_delayTime <= time - sample.first;
+    AddSample(sample.second, previous ? m_delay : delay);
+  }
+  m_pending.clear();
+  m_delay = delay;
+  m_delayTime = time;
+}
+
+void CwndRateEstimator::RttChanged(double time, double rtt) {
+  DelayChanged(time, rtt);
+}
+
+void CwndRateEstimator::RtoChanged(double time, double rto) {
+  DelayChanged(time, rto);
+}
+
+double CwndRateEstimator::GetRate() const {
+  double sum = m_sumRates;
+  uint64_t samples = m_samples;
+  // no later delay sample to compare with, the last one is the nearest
+  if (m_delay > 0) {
+    for (const auto &sample : m_pending) {
+      sum += sample.second / m_delay;
+      samples++;
+    }
+  }
+  if (samples == 0)
+    return 0.0;
+  return sum / samples * 8;
+}
+
+RateEstimators::RateEstimators() {
+  auto google = std::make_unique<GoogleRateEstimator>();
+  m_google = google.get();
+  m_estimators.push_back(std::move(google));
+  m_estimators.push_back(std::make_unique<TxGapsRateEstimator>());
+  m_estimators.push_back(std::make_unique<TxSampleRateEstimator>());
+  m_estimators.push_back(std::make_unique<CumulativeRateEstimator>());
+  m_estimators.push_back(std::make_unique<CwndRateEstimator>());
+}
+
+void RateEstimators::Reset() {
+  for (auto &estimator : m_estimators)
+    estimator->Reset();
+}
+
+void RateEstimators::PacketDelivered(double time, uint32_t bytes) {
+  for (auto &estimator : m_estimators)
+    estimator->PacketDelivered(time, bytes);
+}
+
+void RateEstimators::PacketLost(double time) {
+  for (auto &estimator : m_estimators)
+    estimator->PacketLost(time);
+}
+
+void RateEstimators::CwndChanged(double time, uint32_t cwnd) {
+  for (auto &estimator : m_estimators)
+    estimator->CwndChanged(time, cwnd);
+}
+
+void RateEstimators::RttChanged(double time, double rtt) {
+  for (auto &estimator : m_estimators)
+    estimator->RttChanged(time, rtt);
+}
+
+void RateEstimators::RtoChanged(double time, double rto) {
+  for (auto &estimator : m_estimators)
+    estimator->RtoChanged(time, rto);
+}
+
+void RateEstimators::WriteMetadata(std::ostream &out) const {
+  for (auto &estimator : m_estimators)
+    estimator->WriteMetadata(out);
+}
+
+const GoogleRateEstimator &RateEstimators::GetGoogle() const {
+  return *m_google;
+}
@@ -0,0 +1,217 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Streaming estimate of one quantile (P-square algorithm, Jain & Chlamtac
+// 1985). Keeps five markers instead of the samples, so the median of a
+// column can be followed without storing or sorting it.
+class StreamingQuantile {
+public:
+  explicit StreamingQuantile(double quantile = 0.5);
+
+  void Reset();
+  void Add(double value);
+  double Get() const;
+  uint64_t GetCount() const;
+
+private:
+  double Parabolic(int i, double d) const;
+  double Linear(int i, int d) const;
+
+  double m_quantile;
+  uint64_t m_count;
+  double m_heights[5];   // marker heights
+  double m_positions[5]; // actual marker positions
+  double m_desired[5];   // desired marker positions
+  double m_increment[5]; // increments of the desired positions
+};
+
+// Interface of the policing rate estimators that are computed online from
+// the simulation's trace points. Every estimator is fed the same stream of
+// events and only implements the ones it needs.
+class RateEstimator {
+public:
+  virtual ~RateEstimator() {}
+
+  // Name used as the metadata key prefix, matches RateEstimationMethod
+  virtual std::string GetName() const = 0;
+
+  virtual void Reset() = 0;
+
+  // A packet of `bytes` reached the receiver at `time` seconds
+  virtual void PacketDelivered(double time, uint32_t bytes) {}
+
+  // A packet was dropped by the policer at `time` seconds
+  virtual void PacketLost(double time) {}
+
+  virtual void CwndChanged(double time, uint32_t cwnd) {}
+  virtual void RttChanged(double time, double rtt) {}
+  virtual void RtoChanged(double time, double rto) {}
+
+  // Estimated policing rate in bits per second, 0 without an estimate
+  virtual double GetRate() const = 0;
+
+  // Appends the estimate as key=value lines to a metadata file
+  virtual void WriteMetadata(std::ostream &out) const;
+};
+
+// Online version of the GOOGLE estimate (google_rate_est.get_policing_rate):
+// the bytes delivered between the first and the last loss divided by the
+// time between them. Only running sums are kept, so memory does not grow
+// with the number of packets or losses.
+class GoogleRateEstimator : public RateEstimator {
+public:
+  GoogleRateEstimator();
+
+  std::string GetName() const override;
+  void Reset() override;
+  void PacketDelivered(double time, uint32_t bytes) override;
+  void PacketLost(double time) override;
+  double GetRate() const override;
+  void WriteMetadata(std::ostream &out) const override;
+
+  // True once two losses at different times have been seen
+  bool HasEstimate() const;
+
+  double GetFirstLossTime() const;
+  double GetLastLossTime() const;
+  uint64_t GetDeliveredBytes() const; // between first and last loss
+  uint32_t GetLossCount() const;
+
+  // Rate over the whole reception, from first to last delivered packet
+  double GetRxRate() const;
+
+private:
+  double m_firstLoss;
+  double m_lastLoss;
+  uint64_t m_bytesSinceFirstLoss;
+  uint64_t m_bytesAtLastLoss;
+  uint32_t m_losses;
+
+  double m_firstRx;
+  double m_lastRx;
+  uint64_t m_rxBytes;
+};
+
+// TX_GAPS (explore_rate_est.compute_policing_rate_avg_tx): mean of the
+// delivery rates of the gaps between consecutive losses, including the gap
+// before the first loss and the one after the last.
+class TxGapsRateEstimator : public RateEstimator {
+public:
+  TxGapsRateEstimator();
+
+  std::string GetName() const override;
+  void Reset() override;
+  void PacketDelivered(double time, uint32_t bytes) override;
+  void PacketLost(double time) override;
+  double GetRate() const override;
+
+private:
+  double m_lastLoss;
+  double m_lastPacket;
+  uint64_t m_gapBytes;
+  double m_sumGapRates;
+  uint32_t m_gaps;
+};
+
+// TX_SAMPLE (explore_rate_est.compute_policing_rate_tx_samples): median of
+// the delivery rates of fixed-length bins, with the same binning: a packet
+// past the current bin closes it and moves on by one bin only, and a bin
+// that closes empty counts as a zero rate. Differences: the bin length is
+// the sender's first RTT sample (the pcap version uses the client's initial
+// RTT) unless one is given, packets delivered before that sample fall into
+// the first bin, and the median is the P-square estimate.
+class TxSampleRateEstimator : public RateEstimator {
+public:
+  explicit TxSampleRateEstimator(double sampleTime = 0.0);
+
+  std::string GetName() const override;
+  void Reset() override;
+  void PacketDelivered(double time, uint32_t bytes) override;
+  void RttChanged(double time, double rtt) override;
+  double GetRate() const override;
+
+private:
+  double m_configuredSampleTime;
+  double m_sampleTime;
+  double m_binEnd;
+  uint64_t m_binBytes;
+  StreamingQuantile m_median;
+};
+
+// CUMULATIVE (explore_rate_est.compute_policing_rate_cumulative_df): median
+// of the instantaneous rates (bytes of a packet over the gap since the one
+// before) of the packets whose gap is at least `minGap` seconds. The first
+// packet counts as a zero rate, as in the pcap version. Differences: a
+// packet delivered at the same instant as the one before is left out, where
+// pandas counts an infinite rate that the P-square sketch cannot hold, and
+// the median is the P-square estimate.
+class CumulativeRateEstimator : public RateEstimator {
+public:
+  explicit CumulativeRateEstimator(double minGap = 0.0);
+
+  std::string GetName() const override;
+  void Reset() override;
+  void PacketDelivered(double time, uint32_t bytes) override;
+  double GetRate() const override;
+
+private:
+  double m_minGap;
+  double m_lastPacket;
+  StreamingQuantile m_median;
+};
+
+// CWND (explore_rate_est.compute_using_cwnd): mean of cwnd / delay after
+// `timeBarrier` seconds, where delay is the RTT or RTO sample nearest in
+// time to the cwnd sample, the earlier one on a tie (merge_asof with
+// direction="nearest"). Cwnd samples wait for the next delay sample to be
+// paired; at the end of a run the open ones take the last delay.
+class CwndRateEstimator : public RateEstimator {
+public:
+  explicit CwndRateEstimator(double timeBarrier = 4.0);
+
+  std::string GetName() const override;
+  void Reset() override;
+  void CwndChanged(double time, uint32_t cwnd) override;
+  void RttChanged(double time, double rtt) override;
+  void RtoChanged(double time, double rto) override;
+  double GetRate() const override;
+
+private:
+  void DelayChanged(double time, double delay);
+  void AddSample(uint32_t cwnd, double delay);
+
+  double m_timeBarrier;
+  double m_delay; // latest delay sample, 0 before the first
+  double m_delayTime;
+  // cwnd samples since the latest delay sample, as (time, cwnd)
+  std::vector<std::pair<double, uint32_t>> m_pending;
+  double m_sumRates;
+  uint64_t m_samples;
+};
+
+// All five estimators fed from one event stream, so that a run produces
+// every estimate in a single pass over its packets.
+class RateEstimators {
+public:
+  RateEstimators();
+
+  void Reset();
+  void PacketDelivered(double time, uint32_t bytes);
+  void PacketLost(double time);
+  void CwndChanged(double time, uint32_t cwnd);
+  void RttChanged(double time, double rtt);
+  void RtoChanged(double time, double rto);
+
+  void WriteMetadata(std::ostream &out) const;
+
+  const GoogleRateEstimator &GetGoogle() const;
+
+private:
+  GoogleRateEstimator *m_google; // owned by m_estimators
+  std::vector<std::unique_ptr<RateEstimator>> m_estimators;
+};
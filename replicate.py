@@ -0,0 +1,181 @@
+import argparse
+import csv
+import math
+import os
+from concurrent.futures import ThreadPoolExecutor
+
+import run_sim
+from run_sim import parse_size
+from result_store import ResultStore
+
+# Runs every grid point with independent random streams (--RngRun=1, 2, ...)
+# until the 95% confidence intervals of the throughput and of the GOOGLE
+# error are narrow enough, so replications go where the variance is.
+
+ESTIMATORS = ["google", "tx_gaps", "tx_sample", "cumulative", "cwnd"]
+MIN_LOSSES = 15 # fewer losses give no estimate, see analyse_run
+
+# two-sided 97.5% quantiles of Student's t for 1..30 degrees of freedom
+T_975 = [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+         2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+         2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+
+
+class Welford:
+    """Running mean and variance in one pass."""
+
+    def __init__(self):
+        self.n = 0
+        self.mean = 0.0
+        self.m2 = 0.0
+
+    def add(self, value):
+        self.n += 1
+        delta = value - self.mean
+        self.mean += delta / self.n
+        self.m2 += delta * (value - self.mean)
+
+    def variance(self):
+        return self.m2 / (self.n - 1) if self.n > 1 else float("inf")
+
+    def half_width(self):
+        """Half-width of the 95% confidence interval of the mean."""
+        if self.n < 2:
+            return float("inf")
+        t = T_975[self.n - 2] if self.n - 1 <= len(T_975) else 1.96
+        return t * math.sqrt(self.variance() / self.n)
+
+
+class ReplicatedPoint:
+    def __init__(self, point):
+        self.point = point
+        self.runs = 0
+        self.failed = 0
+        self.throughput = Welford()
+        self.errors = {name: Welford() for name in ESTIMATORS}
+
+    def add(self, results):
+        self.throughput.add(results["throughput"])
+        rx_rate = results.get("rx_rate", 0)
+        for name, stats in self.errors.items():
+            key = f"{name}_rate"
+            if key not in results:
+                continue
+            if results.get("drops", 0) < MIN_LOSSES or not rx_rate:
+                stats.add(1.0)
+            else:
+                stats.add((results[key] - rx_rate) / rx_rate)
+
+    def converged(self, target):
+        # throughput relative to its mean, the error is relative already
+        if self.throughput.n < 2 or self.throughput.mean == 0:
+            return False
+        return (self.throughput.half_width() / self.throughput.mean < target
+                and self.errors["google"].half_width() < target)
+
+
+class Replication:
+    def __init__(self, command, reno, jobs, timeout, target, min_runs, max_runs):
+        self.command = command
+        self.scenario = run_sim.SCENARIO_NAMES[command]
+        self.reno = reno
+        self.jobs = jobs
+        self.timeout = timeout
+        self.target = target
+        self.min_runs = min_runs
+        self.max_runs = max_runs
+        self.command_base = run_sim.get_complete_command(command, no_build=True)
+        self.store = ResultStore(os.path.join(os.path.dirname(os.path.abspath(__file__)), "data"))
+
+    def results(self, point, rng_run):
+        burst, queue_size, ratio = point
+        params = {"burst": int(parse_size(burst)), "queueSize": queue_size,
+                  "reno": int(self.reno), "run": rng_run}
+        if self.command == run_sim.COM_YTOPO:
+            params["trafficRatio"] = ratio
+        records = self.store.find(self.scenario, **params)
+        return records[-1]["results"] if records else None
+
+    def run_one(self, point, rng_run):
+        burst, queue_size, ratio = point
+        # own output files per stream, the point's name is the same for all
+        run_sim.run_simulation_oneshot(burst, queue_size, ratio, self.command, self.command_base,
+                                       self.reno, self.timeout,
+                                       [f"--RngRun={rng_run}", f"--RunId=rng{rng_run}"])
+        return point, rng_run
+
+    def run(self, grid):
+        points = [ReplicatedPoint(point) for point in grid]
+        with ThreadPoolExecutor(max_workers=self.jobs) as pool:
+            while True:
+                # every unfinished point gets its next batch, all run at once;
+                # the fewer points are left, the more replications each gets
+                active = [state for state in points if state.runs < self.max_runs and
+                          not (state.runs >= self.min_runs and state.converged(self.target))]
+                batch = []
+                for state in active:
+                    count = self.min_runs if state.runs == 0 else max(1, self.jobs // len(active))
+                    count = min(count, self.max_runs - state.runs)
+                    batch += [(state, state.runs + i + 1) for i in range(count)]
+                    state.runs += count
+                if not batch:
+                    break
+                print(f"\n*** {len(batch)} replications of {len({id(s) for s, _ in batch})} points ***")
+                futures = [(state, pool.submit(self.run_one, state.point, rng_run))
+                           for state, rng_run in batch]
+                for state, future in futures:
+                    _, rng_run = future.result()
+                    results = self.results(state.point, rng_run)
+                    if results is None:
+                        state.failed += 1
+                        continue
+                    state.add(results)
+        return points
+
+    def save(self, points, path):
+        fields = ["burst", "queue_size", "traffic_ratio", "runs", "failed", "converged",
+                  "throughput_mean", "throughput_half_width"]
+        for name in ESTIMATORS:
+            fields += [f"{name}_error_mean", f"{name}_error_half_width"]
+        with open(path, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=fields)
+            writer.writeheader()
+            for state in points:
+                burst, queue_size, ratio = state.point
+                row = {"burst": burst, "queue_size": queue_size, "traffic_ratio": ratio,
+                       "runs": state.runs, "failed": state.failed,
+                       "converged": state.converged(self.target),
+                       "throughput_mean": state.throughput.mean,
+                       "throughput_half_width": state.throughput.half_width()}
+                for name, stats in state.errors.items():
+                    row[f"{name}_error_mean"] = stats.mean if stats.n else ""
+                    row[f"{name}_error_half_width"] = stats.half_width() if stats.n else ""
+                writer.writerow(row)
+        print(f"Results written to {path}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Replicate every grid point with independent random streams.")
+    parser.add_argument("--command", choices=list(run_sim.SCENARIO_NAMES), required=True,
+                        help="Simulation to replicate.")
+    parser.add_argument("--target", type=float, default=0.01,
+                        help="Half-width of the 95%% confidence interval of the GOOGLE error "
+                             "(and of the throughput, relative to its mean) to stop at.")
+    parser.add_argument("--min-runs", type=int, default=3,
+                        help="Replications per point before the interval is checked.")
+    parser.add_argument("--max-runs", type=int, default=30,
+                        help="Replications per point at most.")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(),
+                        help="Number of simulations to run in parallel.")
+    parser.add_argument("--timeout", type=int, default=run_sim.DEFAULT_TIMEOUT,
+                        help="Timeout of a single simulation in seconds.")
+    parser.add_argument("--reno", action="store_true",
+                        help="Enable TCP NewReno in the simulation.")
+    args = parser.parse_args()
+
+    run_sim.run_build()
+    replication = Replication(args.command, args.reno, args.jobs, args.timeout, args.target,
+                              max(args.min_runs, 2), args.max_runs)
+    points = replication.run(run_sim.get_grid(args.command))
+    replication.save(points, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                          f"data/replications_{args.command}.csv"))
@@ -0,0 +1,159 @@
+#include "result-store.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+ResultRecord::ResultRecord(const std::string &scenario,
+                           const std::string &runId)
+    : m_scenario(scenario), m_runId(runId), m_seed(1), m_run(1) {}
+
+void ResultRecord::SetSeed(uint32_t seed, uint64_t run) {
+  m_seed = seed;
+  m_run = run;
+}
+
+void ResultRecord::SetConfigHash(const std::string &configHash) {
+  m_configHash = configHash;
+}
+
+const std::string &ResultRecord::GetConfigHash() const {
+  return m_configHash;
+}
+
+void ResultRecord::SetParameter(const std::string &name,
+                                const std::string &value) {
+  Set(m_parameters, name, Quote(value));
+}
+
+void ResultRecord::SetParameter(const std::string &name, double value) {
+  Set(m_parameters, name, Number(value));
+}
+
+void ResultRecord::SetFile(const std::string &name, const std::string &path) {
+  Set(m_files, name, Quote(path));
+}
+
+void ResultRecord::ReadMetadata(const std::string &filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Could not open metadata file: " + filename);
+  }
+  SetFile("metadata", filename);
+
+  std::string line;
+  for (const char *name : {"throughput", "drops"}) {
+    if (!std::getline(file, line)) {
+      throw std::runtime_error("Incomplete metadata file: " + filename);
+    }
+    Set(m_results, name, Number(std::stod(line)));
+  }
+  while (std::getline(file, line)) {
+    size_t equals = line.find('=');
+    if (equals == std::string::npos)
+      continue;
+    std::string value = line.substr(equals + 1);
+    // same rule as ExperimentRun: numbers where they parse, else strings
+    size_t parsed = 0;
+    double number = 0;
+    try {
+      number = std::stod(value, &parsed);
+    } catch (const std::exception &e) {
+      parsed = 0;
+    }
+    Set(m_results, line.substr(0, equals),
+        parsed == value.size() && parsed > 0 ? Number(number) : Quote(value));
+  }
+}
+
+std::string ResultRecord::Quote(const std::string &value) {
+  std::string out = "\"";
+  for (char c : value) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        out += escaped;
+      } else {
+        out += c;
+      }
+    }
+  }
+  return out + "\"";
+}
+
+std::string ResultRecord::Number(double value) {
+  // JSON has no nan or inf
+  if (!std::isfinite(value))
+    return "null";
+  std::ostringstream out;
+  out.precision(15);
+  out << value;
+  return out.str();
+}
+
+void ResultRecord::Set(Fields &fields, const std::string &name,
+                       const std::string &json) {
+  for (auto &field : fields) {
+    if (field.first == name) {
+      field.second = json;
+      return;
+    }
+  }
+  fields.emplace_back(name, json);
+}
+
+void ResultRecord::WriteObject(std::string &out, const Fields &fields) {
+  out += "{";
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (i > 0)
+      out += ",";
+    out += Quote(fields[i].first) + ":" + fields[i].second;
+  }
+  out += "}";
+}
+
+std::string ResultRecord::ToJson() const {
+  std::string out = "{\"scenario\":" + Quote(m_scenario) +
+                    ",\"run_id\":" + Quote(m_runId) +
+                    ",\"seed\":" + std::to_string(m_seed) +
+                    ",\"run\":" + std::to_string(m_run) +
+                    ",\"config_hash\":" + Quote(m_configHash) +
+                    ",\"params\":";
+  WriteObject(out, m_parameters);
+  out += ",\"results\":";
+  WriteObject(out, m_results);
+  out += ",\"files\":";
+  WriteObject(out, m_files);
+  return out + "}";
+}
+
+void ResultRecord::Append(const std::string &filename) const {
+  std::string line = ToJson() + "\n";
+  int fd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open result store: " + filename);
+  }
+  ssize_t written = write(fd, line.data(), line.size());
+  close(fd);
+  if (written != static_cast<ssize_t>(line.size())) {
+    throw std::runtime_error("Could not append to result store: " + filename);
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One run's entry in the result store: the scenario, its parameters and
+// seed, the throughput, drop count and estimator outputs of its metadata
+// file and where its output files are. Runs append their record as one
+// JSON line to a single file; result_store.py indexes it in SQLite so the
+// analysis looks runs up by parameter instead of scanning data/.
+class ResultRecord {
+public:
+  ResultRecord(const std::string &scenario, const std::string &runId);
+
+  void SetSeed(uint32_t seed, uint64_t run);
+  // Identifies the run's configuration, see getConfigHash in utils.h
+  void SetConfigHash(const std::string &configHash);
+  const std::string &GetConfigHash() const;
+  void SetParameter(const std::string &name, const std::string &value);
+  void SetParameter(const std::string &name, double value);
+  void SetFile(const std::string &name, const std::string &path);
+
+  // Takes the throughput, drop count and key=value lines of a metadata file
+  void ReadMetadata(const std::string &filename);
+
+  std::string ToJson() const;
+  // A single write to a file opened for appending, so records of
+  // concurrent runs do not interleave
+  void Append(const std::string &filename) const;
+
+private:
+  // values are kept as JSON already, numbers bare and strings quoted
+  typedef std::vector<std::pair<std::string, std::string>> Fields;
+
+  static std::string Quote(const std::string &value);
+  static std::string Number(double value);
+  static void Set(Fields &fields, const std::string &name,
+                  const std::string &json);
+  static void WriteObject(std::string &out, const Fields &fields);
+
+  std::string m_scenario;
+  std::string m_runId;
+  uint32_t m_seed;
+  uint64_t m_run;
+  std::string m_configHash;
+  Fields m_parameters;
+  Fields m_results;
+  Fields m_files;
+};
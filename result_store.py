@@ -0,0 +1,212 @@
+import argparse
+import json
+import os
+import sqlite3
+
+# every run appends one JSON record to STORE_FILE (see result-store.h);
+# INDEX_FILE is an SQLite index of those records, updated incrementally
+STORE_FILE = "wehe_results.jsonl"
+INDEX_FILE = "wehe_results.sqlite"
+
+SCHEMA = """
+CREATE TABLE IF NOT EXISTS runs (
+    id INTEGER PRIMARY KEY,
+    scenario TEXT,
+    run_id TEXT,
+    seed INTEGER,
+    run INTEGER,
+    config_hash TEXT,
+    metadata_file TEXT,
+    current INTEGER,
+    record TEXT
+);
+CREATE TABLE IF NOT EXISTS params (
+    run INTEGER,
+    name TEXT,
+    value
+);
+CREATE TABLE IF NOT EXISTS ingest (
+    offset INTEGER
+);
+CREATE INDEX IF NOT EXISTS runs_scenario ON runs (scenario);
+CREATE INDEX IF NOT EXISTS runs_metadata ON runs (metadata_file);
+CREATE INDEX IF NOT EXISTS runs_config ON runs (config_hash);
+CREATE INDEX IF NOT EXISTS params_lookup ON params (name, value, run);
+"""
+
+# output written before the store existed is named
+# wehe_metadata_<sim name>_<burst>_<queue size>_[<run id>_]; a sim name is a
+# scenario with a "reno-" prefix for NewReno and, for these scenarios, the
+# parameter after its last "-"
+LEGACY_PREFIX = "wehe_metadata_"
+RENO_PREFIX = "reno-"
+LEGACY_SIM_PARAMS = {"xtopo": "trafficRatio", "xtopo-mpi": "trafficRatio", "aggregate": "flows"}
+
+
+def parse_value(value):
+    """Numbers where they parse, else strings, as ResultRecord::ReadMetadata does."""
+    try:
+        number = float(value)
+    except ValueError:
+        return value
+    return int(number) if number.is_integer() else number
+
+
+def legacy_record(data_dir, filename):
+    """The store record of a metadata file written before the store, or None."""
+    parts = filename[len(LEGACY_PREFIX):].split("_")
+    if parts and parts[-1] == "":
+        parts.pop()
+    if len(parts) < 3:
+        return None
+    sim_name, burst, queue_size = parts[:3]
+
+    params = {"burst": parse_value(burst), "queueSize": queue_size, "reno": 0}
+    if sim_name.startswith(RENO_PREFIX):
+        sim_name = sim_name[len(RENO_PREFIX):]
+        params["reno"] = 1
+    scenario, _, value = sim_name.rpartition("-")
+    if scenario in LEGACY_SIM_PARAMS:
+        params[LEGACY_SIM_PARAMS[scenario]] = parse_value(value)
+    else:
+        scenario = sim_name
+
+    results = {}
+    with open(os.path.join(data_dir, filename)) as f:
+        lines = f.read().splitlines()
+    if len(lines) < 2:
+        return None
+    results["throughput"] = parse_value(lines[0])
+    results["drops"] = parse_value(lines[1])
+    for line in lines[2:]:
+        name, equals, value = line.partition("=")
+        if equals:
+            results[name] = parse_value(value)
+
+    metadata = os.path.join(data_dir, filename)
+    return {"scenario": scenario, "run_id": "_".join(parts[3:]), "seed": None, "run": None,
+            "config_hash": None, "params": params, "results": results,
+            "files": {"metadata": metadata, "sim": metadata.replace("metadata", "sim", 1)}}
+
+
+class ResultStore:
+    def __init__(self, data_dir="data/"):
+        self.data_dir = data_dir
+        self.store_path = os.path.join(data_dir, STORE_FILE)
+        self.db = sqlite3.connect(os.path.join(data_dir, INDEX_FILE))
+        self.db.executescript(SCHEMA)
+
+    def exists(self):
+        return os.path.exists(self.store_path)
+
+    def close(self):
+        self.db.close()
+
+    def _offset(self):
+        row = self.db.execute("SELECT offset FROM ingest").fetchone()
+        return row[0] if row else 0
+
+    def sync(self):
+        """Indexes the records appended since the last sync."""
+        if not self.exists():
+            return 0
+        offset = self._offset()
+        if os.path.getsize(self.store_path) < offset:
+            # the store was replaced, start over
+            self.db.executescript("DELETE FROM runs; DELETE FROM params; DELETE FROM ingest;")
+            offset = 0
+
+        added = 0
+        with open(self.store_path, "rb") as f:
+            f.seek(offset)
+            for line in f:
+                if not line.endswith(b"\n"):
+                    break  # a run is still writing it
+                offset += len(line)
+                if line.strip():
+                    self._insert(json.loads(line))
+                    added += 1
+        self.db.execute("DELETE FROM ingest")
+        self.db.execute("INSERT INTO ingest (offset) VALUES (?)", (offset,))
+        self.db.commit()
+        return added
+
+    def _insert(self, record):
+        metadata_file = record["files"].get("metadata")
+        # a rerun of a point overwrites its output files
+        self.db.execute("UPDATE runs SET current = 0 WHERE metadata_file = ?", (metadata_file,))
+        cursor = self.db.execute(
+            "INSERT INTO runs (scenario, run_id, seed, run, config_hash, metadata_file, current, record) "
+            "VALUES (?, ?, ?, ?, ?, ?, 1, ?)",
+            (record["scenario"], record["run_id"], record["seed"], record["run"],
+             record.get("config_hash"), metadata_file, json.dumps(record)))
+        params = dict(record["params"], seed=record["seed"], run=record["run"])
+        self.db.executemany(
+            "INSERT INTO params (run, name, value) VALUES (?, ?, ?)",
+            [(cursor.lastrowid, name, value) for name, value in params.items()])
+
+    def find(self, scenario=None, latest=True, **params):
+        """Records of the runs with these parameters, e.g. find("xtopo", trafficRatio=0.5).
+
+        With latest, a point that was run more than once only gives its last
+        record, the one its output files are from.
+        """
+        self.sync()
+        query = "SELECT record FROM runs WHERE 1"
+        values = []
+        if scenario is not None:
+            query += " AND scenario = ?"
+            values.append(scenario)
+        for name, value in params.items():
+            query += " AND id IN (SELECT run FROM params WHERE name = ? AND value = ?)"
+            values += [name, value]
+        if latest:
+            query += " AND current = 1"
+        query += " ORDER BY id"
+        return [json.loads(row[0]) for row in self.db.execute(query, values)]
+
+    def has_config(self, config_hash):
+        """Whether a run of this configuration completed; the simulations skip those themselves."""
+        self.sync()
+        return self.db.execute("SELECT 1 FROM runs WHERE config_hash = ? LIMIT 1", (config_hash,)).fetchone() is not None
+
+    def import_legacy(self):
+        """Appends a record for every metadata file of data_dir that is not in the store yet.
+
+        Run once on a data directory from before the store, so the analysis
+        finds those runs by lookup too. Their seed, run and config hash are
+        unknown and left null.
+        """
+        self.sync()
+        stored = {os.path.basename(row[0]) for row in self.db.execute("SELECT metadata_file FROM runs") if row[0]}
+        lines = []
+        for filename in sorted(os.listdir(self.data_dir)):
+            if not filename.startswith(LEGACY_PREFIX) or filename in stored:
+                continue
+            record = legacy_record(self.data_dir, filename)
+            if record is not None:
+                lines.append(json.dumps(record) + "\n")
+        if lines:
+            with open(self.store_path, "a") as f:
+                f.write("".join(lines))
+        self.sync()
+        return len(lines)
+
+    def local_path(self, path):
+        """Where a file a record names is from here; runs write paths relative to the ns-3 root."""
+        return os.path.join(self.data_dir, os.path.basename(path))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Maintain the result store of a data directory.")
+    parser.add_argument("--data", default="data/", help="Data directory of the store.")
+    parser.add_argument("--import-legacy", action="store_true",
+                        help="Add the runs written before the store existed.")
+    args = parser.parse_args()
+
+    store = ResultStore(args.data)
+    if args.import_legacy:
+        print(f"Imported {store.import_legacy()} runs into {store.store_path}")
+    else:
+        print(f"{store.sync()} new records indexed")
+    store.close()
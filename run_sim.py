@@ -2,6 +2,9 @@ import subprocess
 import os
 import argparse
 import time
+import queue
+import re
+import threading
 
 COMMAND_BASE = [
         "../.././ns3",
@@ -13,11 +16,26 @@ COM_SHAPING = "shaping"
 COM_SHAPING_COMPLEX = "complex-shaping"
 COM_YTOPO = "two-servers"
 
+# scenario each command records in the result store (see result_store.py)
+SCENARIO_NAMES = {
+    COM_SHAPING: "shaping",
+    COM_SHAPING_COMPLEX: "complex-shaping",
+    COM_YTOPO: "xtopo",
+}
+
 START_TIME = time.time()
 
-def get_complete_command(command):
-    complete = COMMAND_BASE
+DEFAULT_TIMEOUT = 120 # seconds per simulation
+
+# options passed to every simulation, set from the command line
+SIM_OPTIONS = []
+
+def get_complete_command(command, no_build=False):
+    complete = list(COMMAND_BASE)
     complete[2] = complete[2] + command
+    if no_build:
+        # concurrent runs must not all try to rebuild the tree
+        complete.insert(2, "--no-build")
     return complete
 
 def run_build():
@@ -26,6 +44,8 @@ def run_build():
         subprocess.run(command, cwd=os.path.dirname(__file__), check=True, text=True)
     except subprocess.CalledProcessError as e:
         print("Error during build:", e.stderr)
+        return False
+    return True
         
 def process_results(arg):
     command = ["python3", "google-paper-rate-estimation.py",
@@ -35,7 +55,7 @@ def process_results(arg):
     except subprocess.CalledProcessError as e:
         print("Error during result processing:", e.stderr)
 
-def run_simulation_oneshot(burst, queueSize, ratio, command_name, command_base=COMMAND_BASE, reno=False):
+def run_simulation_oneshot(burst, queueSize, ratio, command_name, command_base=COMMAND_BASE, reno=False, timeout=DEFAULT_TIMEOUT, extra_options=()):
     command = command_base + [
         "--",
         f"--burst={burst}",
@@ -46,17 +66,19 @@ def run_simulation_oneshot(burst, queueSize, ratio, command_name, command_base=C
     
     if reno:
         command.append(f"--reno=1")
+    command += SIM_OPTIONS + list(extra_options)
     try:
-        subprocess.run(command, cwd=os.path.dirname(__file__), check=True, text=True, timeout=120)
+        subprocess.run(command, cwd=os.path.dirname(__file__), check=True, text=True, timeout=timeout)
     except subprocess.TimeoutExpired as e:
         print(f"Command timed out after {e.timeout} seconds")
+        return False
     except subprocess.CalledProcessError as e:
         print("Error during simulation:", e.stderr)
+        return False
+    return True
     
 
-def run_exp(command, reno = False):
-    
-    command_base = get_complete_command(command)
+def get_grid(command):
     
     link_count = 3 if command == COM_YTOPO else 2
     
@@ -98,25 +120,118 @@ def run_exp(command, reno = False):
     else:
         ratios = [1.0]
     
+    return [(b, q, r) for r in ratios for b in bursts for q in queueSizes]
+
+
+def write_sweep_file(grid, command):
+    # one "burst,queueSize,trafficRatio" line per point, read by the simulation's --sweep
+    path = os.path.join(os.path.dirname(os.path.abspath(__file__)), f"sweep_{command}.csv")
+    with open(path, 'w') as f:
+        for b, q, r in grid:
+            f.write(f"{b},{q},{r}\n")
+    return path
+
+
+def run_sweep(command, reno = False, timeout = DEFAULT_TIMEOUT, fork_jobs = 0):
+    command_base = get_complete_command(command)
+    grid = get_grid(command)
+    
+    sweep_file = write_sweep_file(grid, command)
+    print(f"Running {len(grid)} simulations in one process from {sweep_file}")
+    
+    sweep_command = command_base + ["--", f"--sweep={sweep_file}"]
+    if reno:
+        sweep_command.append(f"--reno=1")
+    if fork_jobs > 0:
+        # xtopo only: topology built once per trafficRatio, one child process per point
+        sweep_command += ["--fork=1", f"--forkJobs={fork_jobs}"]
+    sweep_command += SIM_OPTIONS
+    try:
+        subprocess.run(sweep_command, cwd=os.path.dirname(__file__), check=True, text=True, timeout=timeout * len(grid))
+    except subprocess.TimeoutExpired as e:
+        print(f"Command timed out after {e.timeout} seconds")
+    except subprocess.CalledProcessError as e:
+        print("Error during simulation:", e.stderr)
+    
+    print("All simulations completed.")
+
+
+def parse_size(size):
+    return float(re.match(r'([\d.]+)', str(size)).group(1))
+
+
+def expected_cost(point):
+    # large queues drain slowly and large bursts let more data through, so
+    # these points are started first to keep them off the tail of the run
+    b, q, r = point
+    return (r, parse_size(q), parse_size(b))
+
+
+def run_exp_parallel(command, reno = False, jobs = os.cpu_count(), timeout = DEFAULT_TIMEOUT):
+    command_base = get_complete_command(command, no_build=True)
+    grid = sorted(get_grid(command), key=expected_cost, reverse=True)
+    size = len(grid)
+    
+    # one shared queue: a worker takes the next point as soon as it is idle,
+    # so slow points never hold back points assigned to other workers
+    pending = queue.Queue()
+    for point in grid:
+        pending.put(point)
+    
+    lock = threading.Lock()
+    done = []
+    failed = []
+    
+    def worker(worker_id):
+        while True:
+            try:
+                b, q, r = pending.get_nowait()
+            except queue.Empty:
+                return
+            print(f"[worker {worker_id}] burst: {b}, queueSize: {q}, ratio: {r}")
+            ok = run_simulation_oneshot(b, q, r, command, command_base, reno, timeout)
+            with lock:
+                done.append((b, q, r))
+                if not ok:
+                    failed.append((b, q, r))
+                elapsed_time = time.time() - START_TIME
+                estimated_finish = START_TIME + elapsed_time / len(done) * size
+                finish_time = time.strftime('%H:%M:%S', time.localtime(estimated_finish))
+                print(f"\n[worker {worker_id}] {len(done)}/{size} done. Estimated finish time: {finish_time} (hh:mm:ss)\n")
+    
+    workers = [threading.Thread(target=worker, args=(i,)) for i in range(min(jobs, size))]
+    for w in workers:
+        w.start()
+    for w in workers:
+        w.join()
+    
+    if failed:
+        print(f"{len(failed)} simulations failed or timed out: {failed}")
+    print("All simulations completed.")
+
+
+def run_exp(command, reno = False, timeout = DEFAULT_TIMEOUT):
+    
+    command_base = get_complete_command(command)
+    grid = get_grid(command)
+    
     i = 1
-    size = len(bursts) * len(queueSizes) * len(ratios)
+    size = len(grid)
     average_elapsed_time = 0.0
     sum_elapsed_time = 0.0
-    for r in ratios:
-        for b in bursts:
-            for q in queueSizes:
-                print(f"Running simulation with burst: {b}, queueSize: {q}, ratio: {r} | {i}/{size}")
-                last_time = time.time()
-                run_simulation_oneshot(b, q, r, command, command_base, reno)
-                current_time = time.time()
-                elapsed_time = current_time - last_time
-                sum_elapsed_time += elapsed_time
-                average_elapsed_time = sum_elapsed_time / i
-                estimated_finish = START_TIME + average_elapsed_time * size 
-                finish_time = time.strftime('%H:%M:%S', time.localtime(estimated_finish))
-                print(f"\nElapsed time for this simulation: {elapsed_time:.2f} seconds. Estimated finish time: {finish_time} (hh:mm:ss)\n")
-                i += 1
-                # delete_unnecessary_files()
+    for b, q, r in grid:
+        print(f"Running simulation with burst: {b}, queueSize: {q}, ratio: {r} | {i}/{size}")
+        last_time = time.time()
+        run_simulation_oneshot(b, q, r, command, command_base, reno, timeout)
+        current_time = time.time()
+        elapsed_time = current_time - last_time
+        sum_elapsed_time += elapsed_time
+        average_elapsed_time = sum_elapsed_time / i
+        estimated_finish = START_TIME + average_elapsed_time * size 
+        finish_time = time.strftime('%H:%M:%S', time.localtime(estimated_finish))
+        print(f"\nElapsed time for this simulation: {elapsed_time:.2f} seconds. Estimated finish time: {finish_time} (hh:mm:ss)\n")
+        i += 1
+        # delete_unnecessary_files()
                 
     print("All simulations completed.") 
     
@@ -160,12 +275,91 @@ if __name__ == "__main__":
         help="Enable TCP NewReno in the simulation."
     )
     
+    parser.add_argument(
+        "--sweep",
+        action="store_true",
+        help="Run the whole grid inside one simulation process."
+    )
+    
+    parser.add_argument(
+        "--jobs",
+        type=int,
+        default=1,
+        help="Number of simulations to run in parallel."
+    )
+    
+    parser.add_argument(
+        "--timeout",
+        type=int,
+        default=DEFAULT_TIMEOUT,
+        help="Timeout of a single simulation in seconds."
+    )
+    
+    parser.add_argument(
+        "--event-log",
+        action="store_true",
+        help="Write binary event logs instead of full pcaps."
+    )
+    
+    parser.add_argument(
+        "--policer",
+        action="store_true",
+        help="Police with ns3::PolicerQueueDisc instead of ns3::TbfQueueDisc."
+    )
+    
+    parser.add_argument(
+        "--police-classes",
+        metavar="SPEC",
+        help="Police only these classes with ns3::ClassPolicerQueueDisc, e.g. \"dport=7\"."
+    )
+    
+    parser.add_argument(
+        "--rerun",
+        action="store_true",
+        help="Simulate points again even if the result store already has them."
+    )
+    
+    parser.add_argument(
+        "--fast-forward",
+        action="store_true",
+        help="Replay the steady-state loss cycle instead of simulating it."
+    )
+    
+    parser.add_argument(
+        "--early-stop",
+        action="store_true",
+        help="Stop runs once the rate estimate converged or nothing was dropped for 2 s."
+    )
+    
+    parser.add_argument(
+        "--fork",
+        action="store_true",
+        help="With --sweep on xtopo, fork every point from one built topology (--jobs at once)."
+    )
     
     get_current_time()
     
     run_build()
     args = parser.parse_args()
-    run_exp(args.command, args.reno)
+    if args.event_log:
+        SIM_OPTIONS += ["--EventLog=1", "--Pcap=0"]
+    if args.policer:
+        SIM_OPTIONS += ["--QueueDisc=ns3::PolicerQueueDisc"]
+    if args.police_classes:
+        SIM_OPTIONS += ["--QueueDisc=ns3::ClassPolicerQueueDisc",
+                        f"--ns3::ClassPolicerQueueDisc::Classes={args.police_classes}"]
+    if args.rerun:
+        SIM_OPTIONS += ["--SkipCompleted=0"]
+    if args.fast_forward:
+        SIM_OPTIONS += ["--FastForward=1"]
+    if args.early_stop:
+        SIM_OPTIONS += ["--ConvergenceThreshold=0.01", "--DropTimeout=2"]
+    if args.sweep:
+        run_sweep(args.command, args.reno, args.timeout, args.jobs if args.fork else 0)
+    elif args.jobs > 1:
+        run_exp_parallel(args.command, args.reno, args.jobs, args.timeout)
+    else:
+        run_exp(args.command, args.reno, args.timeout)
     if args.command == COM_YTOPO:
         args.command = "xtopo"
     
@@ -0,0 +1,148 @@
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+import benchmark
+from result_store import STORE_FILE, ResultStore
+
+# known-answer checks of the pieces that run without ns-3: tools/self-check
+# covers the C++ modules, this script the result store and benchmark.py
+HERE = os.path.dirname(os.path.abspath(__file__))
+SELF_CHECK = os.path.join(HERE, "tools", "self-check")
+SOURCES = ["rate-estimator.cc", "alias-table.cc", "fast-forward.cc", "convergence.cc", "flow-table.cc", "result-store.cc", "config-hash.cc"]
+
+failures = []
+
+
+def check(ok, what):
+    if not ok:
+        print("FAIL:", what)
+        failures.append(what)
+
+
+def build_self_check():
+    command = ["g++", "-std=c++17", "-I" + HERE, "-o", SELF_CHECK, os.path.join(HERE, "tools", "self-check.cc")]
+    command += [os.path.join(HERE, source) for source in SOURCES]
+    try:
+        subprocess.run(command, check=True, capture_output=True, text=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print("Could not build tools/self-check:", getattr(e, "stderr", e))
+        return False
+    return True
+
+
+def run_self_check(work_dir, store_path):
+    """Runs the C++ checks, which append their record to store_path."""
+    result = subprocess.run([SELF_CHECK, store_path], cwd=work_dir, capture_output=True, text=True)
+    print(result.stdout, end="")
+    check(result.returncode == 0, "tools/self-check")
+
+
+def check_result_store(work_dir):
+    store_path = os.path.join(work_dir, STORE_FILE)
+    run_self_check(work_dir, store_path)
+    with open(store_path) as f:
+        written = json.loads(f.readline())
+
+    store = ResultStore(work_dir)
+    try:
+        found = store.find("self-check", burst=15000, queueSize="1500B")
+        check(found == [written], "result store round trip of the C++ record")
+        check(store.find("self-check", burst=12000) == [], "result store parameter lookup")
+        check(store.has_config("0123456789abcdef"), "result store config hash")
+        check(not store.has_config("fedcba9876543210"), "result store unknown config hash")
+
+        # a rerun of the point replaces it, a line still being written waits
+        run_self_check(work_dir, store_path)
+        with open(store_path, "a") as f:
+            f.write('{"scenario": "self-check"')
+        check(store.sync() == 1, "result store indexes only the new complete line")
+        check(len(store.find("self-check")) == 1, "result store keeps the latest run of a point")
+        check(len(store.find("self-check", latest=False)) == 2, "result store keeps every run")
+    finally:
+        store.close()
+
+
+def check_legacy_import(work_dir):
+    files = {
+        "wehe_metadata_reno-xtopo-0.5_12000_1500B_": "15000000\n12\ngoogle_rate=1e7\nstop_reason=end\n",
+        "wehe_metadata_shaping_15000_3000B_rng2_": "9500000.5\n3\n",
+        "wehe_sim_shaping_15000_3000B_rng2_n0-n1-2-0.pcap": "",
+    }
+    for name, text in files.items():
+        with open(os.path.join(work_dir, name), "w") as f:
+            f.write(text)
+
+    store = ResultStore(work_dir)
+    try:
+        check(store.import_legacy() == 2, "legacy import of the metadata files")
+        check(store.import_legacy() == 0, "legacy import skips runs in the store")
+        xtopo = store.find("xtopo", reno=1, trafficRatio=0.5, burst=12000, queueSize="1500B")
+        check(len(xtopo) == 1 and xtopo[0]["results"] == {"throughput": 15000000, "drops": 12,
+                                                          "google_rate": 10000000, "stop_reason": "end"},
+              f"legacy import of a reno xtopo run: {xtopo}")
+        shaping = store.find("shaping", reno=0)
+        check(len(shaping) == 1 and shaping[0]["run_id"] == "rng2"
+              and shaping[0]["results"]["throughput"] == 9500000.5
+              and os.path.basename(shaping[0]["files"]["sim"]) == "wehe_sim_shaping_15000_3000B_rng2_",
+              f"legacy import of a shaping run: {shaping}")
+    finally:
+        store.close()
+
+
+def check_benchmark(work_dir):
+    output = ("*** Run cost ***\nEvents executed: 123456\nSimulated time: 12.5 s\n"
+              "Wall time: 3.25 s\nProcess peak RSS: 20480 kB\n"
+              "Wall time per simulated second: 0.26 s\n")
+    costs = {name: parse(regex.search(output).group(1)) for name, (regex, parse) in benchmark.COST_RE.items()}
+    check(costs == {"events": 123456, "simulated_time": 12.5, "wall_time": 3.25, "process_peak_rss_kb": 20480},
+          f"benchmark run cost parsing: {costs}")
+    match = benchmark.WALL_PER_SIM_RE.search(output)
+    check(match is not None and float(match.group(1)) == 0.26, "benchmark wall time per simulated second")
+
+    output_root = os.path.join(work_dir, "output")
+    os.makedirs(output_root)
+    for name, size in [("a.pcap", 100), ("b.csv", 20), (STORE_FILE, 1000)]:
+        with open(os.path.join(output_root, name), "wb") as f:
+            f.write(b"x" * size)
+    check(benchmark.directory_size(output_root) == 120, "benchmark output size leaves out the result store")
+
+    # the mains an interrupted suite left aside come back, without
+    # overwriting one that is in the main directory again
+    here = benchmark.HERE
+    benchmark.HERE = work_dir
+    try:
+        stash = os.path.join(work_dir, benchmark.STASH_DIR)
+        os.makedirs(stash)
+        for directory, name, text in [(stash, "WeHeY-simulation.cc", "stashed"),
+                                      (stash, "WeHeY-simulation-shaping.cc", "stashed"),
+                                      (work_dir, "WeHeY-simulation-shaping.cc", "current")]:
+            with open(os.path.join(directory, name), "w") as f:
+                f.write(text)
+        benchmark.restore_mains()
+        with open(os.path.join(work_dir, "WeHeY-simulation.cc")) as f:
+            check(f.read() == "stashed", "benchmark restores a stashed main")
+        with open(os.path.join(work_dir, "WeHeY-simulation-shaping.cc")) as f:
+            check(f.read() == "current", "benchmark keeps the main in the main directory")
+        check(not os.path.exists(stash), "benchmark removes the stash")
+    finally:
+        benchmark.HERE = here
+
+
+if __name__ == "__main__":
+    with tempfile.TemporaryDirectory(prefix="wehe_self_check_") as work_dir:
+        if build_self_check():
+            check_result_store(work_dir)
+        else:
+            failures.append("build")
+    with tempfile.TemporaryDirectory(prefix="wehe_self_check_") as work_dir:
+        check_legacy_import(work_dir)
+    with tempfile.TemporaryDirectory(prefix="wehe_self_check_") as work_dir:
+        check_benchmark(work_dir)
+
+    if failures:
+        print(f"{len(failures)} checks failed")
+        sys.exit(1)
+    print("All Python checks passed")
@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2015 Universita' degli Studi di Napoli "Federico II"
+ *               2017 Kungliga Tekniska Högskolan
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: Pasquale Imputato <p.imputato@gmail.com>
+ * Author: Stefano Avallone <stefano.avallone@unina.it>
+ * Author: Surya Seetharaman <suryaseetharaman.9@gmail.com> - ported from ns-3
+ *         RedQueueDisc traffic-control example to accommodate TbfQueueDisc
+ * example.
+ */
+
+#include "complex-send-app.h"
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/tcp-header.h"
+#include "ns3/traffic-control-module.h"
+#include "flow-table.h"
+#include "rate-estimator.h"
+#include "utils.h"
+
+#include <fstream> // store throughput data
+#include <string>
+#include <vector>
+
+// Aggregate policing: N senders share one TBF, as at an ISP policer.
+//
+// Network topology
+//
+// s_0 -----|
+// s_1 -----|
+//  ...     n_r (TBF) ----- n_d
+// s_N-1 ---|
+//    point-to-point links
+//
+// Flow i goes from s_i to port BASE_PORT + i of n_d, so a packet's flow is
+// its destination port. Every flow is counted in one FlowTable, written to
+// the <flows> CSV. Flow 0 is the measurement flow: it gets the pcaps, the
+// cwnd/rtt/rto traces and the online estimators, like the other scenarios.
+//
+// Routes are static default routes towards the TBF node, global routing
+// would build a table of every subnet on every node.
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("TbfExample");
+
+static const uint32_t MIN_SEND_RATE = 1;
+static const uint32_t MAX_SEND_RATE = 1448;
+
+static const uint16_t BASE_PORT = 10000;
+
+static const std::string SIM_NAME = "aggregate";
+
+static RateEstimators estimators;
+static FlowTable flows;
+
+static TraceSink cwndFile;
+static TraceSink rttFile;
+static TraceSink rtoFile;
+static TraceSink tokensFile;
+
+static std::ofstream droppedPacketsFile;
+
+static uint32_t GetFlow(uint16_t port) { return port - BASE_PORT; }
+
+static void Ipv4RxTrace(Ptr<const Packet> packet, Ptr<Ipv4> ipv4,
+                        uint32_t interface) {
+  // the packet still has its IPv4 header here
+  Ptr<Packet> copy = packet->Copy();
+  Ipv4Header ipHeader;
+  TcpHeader tcpHeader;
+  copy->RemoveHeader(ipHeader);
+  if (!copy->PeekHeader(tcpHeader))
+    return;
+
+  double now = Simulator::Now().GetSeconds();
+  uint32_t flow = GetFlow(tcpHeader.GetDestinationPort());
+  flows.PacketDelivered(flow, now, packet->GetSize());
+  if (flow == 0)
+    estimators.PacketDelivered(now, packet->GetSize());
+}
+
+void PacketDropCallback(Ptr<const QueueDiscItem> item) {
+  double dropSeconds = Simulator::Now().GetSeconds();
+
+  TcpHeader tcpHeader;
+  Ptr<const Packet> packet = item->GetPacket();
+  if (!packet->PeekHeader(tcpHeader))
+    return;
+
+  uint32_t flow = GetFlow(tcpHeader.GetDestinationPort());
+  flows.PacketLost(flow, dropSeconds);
+  if (flow != 0)
+    return;
+
+  estimators.PacketLost(dropSeconds);
+  droppedPacketsFile << dropSeconds << ","
+                     << tcpHeader.GetSequenceNumber().GetValue() << ","
+                     << packet->GetSize() << std::endl;
+}
+
+static void CwndTracer(uint32_t oldCwnd, uint32_t newCwnd) {
+  estimators.CwndChanged(Simulator::Now().GetSeconds(), newCwnd);
+  cwndFile.Write(Simulator::Now().GetSeconds(), newCwnd);
+}
+
+static void RttTracer(Time oldRtt, Time newRtt) {
+  estimators.RttChanged(Simulator::Now().GetSeconds(), newRtt.GetSeconds());
+  rttFile.Write(Simulator::Now().GetSeconds(), newRtt.GetSeconds());
+}
+
+static void RtoTracer(Time oldRto, Time newRto) {
+  estimators.RtoChanged(Simulator::Now().GetSeconds(), newRto.GetSeconds());
+  rtoFile.Write(Simulator::Now().GetSeconds(), newRto.GetSeconds());
+}
+
+void ConnectCwndTrace(Ptr<ComplexSendApplication> app) {
+  Ptr<Socket> sock = app->GetSocket();
+  if (sock) {
+    sock->TraceConnectWithoutContext("CongestionWindow",
+                                     MakeCallback(&CwndTracer));
+    sock->TraceConnectWithoutContext("RTT", MakeCallback(&RttTracer));
+    sock->TraceConnectWithoutContext("RTO", MakeCallback(&RtoTracer));
+  } else
+    NS_LOG_ERROR("Socket still null at connect time");
+}
+
+static void RunSimulation(uint32_t flowCount, uint32_t burst,
+                          std::string queueSize, uint32_t mtu, DataRate rate,
+                          DataRate peakRate, DataRate accessRate,
+                          double simulationTime, double startSpread,
+                          uint32_t reno) {
+  double simStart = 0.1;
+  double simEnd = simulationTime - 1;
+
+  uint32_t payloadSize = 1448; // bytes
+
+  std::string sim_name_full = SIM_NAME + "-" + std::to_string(flowCount);
+  if (reno) {
+    sim_name_full = "reno-" + sim_name_full;
+  }
+
+  std::vector<std::string> args;
+  args.push_back(std::to_string(burst));
+  args.push_back(queueSize);
+  if (isCompleted(getConfigHash(sim_name_full, args))) {
+    std::cout << "Skipping " << flowCount << " flows, burst " << burst
+              << ", queueSize " << queueSize
+              << ": already in the result store" << std::endl;
+    return;
+  }
+
+  flows.Resize(flowCount);
+
+  NodeContainer senders;
+  senders.Create(flowCount);
+  NodeContainer nodes; // TBF node, destination
+  nodes.Create(2);
+
+  PointToPointHelper pointToPointAccess;
+  pointToPointAccess.SetDeviceAttribute("DataRate", DataRateValue(accessRate));
+  pointToPointAccess.SetChannelAttribute("Delay", StringValue("5ms"));
+
+  PointToPointHelper pointToPointBottleneck;
+  pointToPointBottleneck.SetDeviceAttribute(
+      "DataRate", StringValue("1Gb/s")); // link bandwidth
+  pointToPointBottleneck.SetChannelAttribute("Delay", StringValue("5ms"));
+
+  std::vector<NetDeviceContainer> accessDevices;
+  accessDevices.reserve(flowCount);
+  for (uint32_t i = 0; i < flowCount; i++)
+    accessDevices.push_back(
+        pointToPointAccess.Install(senders.Get(i), nodes.Get(0)));
+  NetDeviceContainer bottleneckDevices =
+      pointToPointBottleneck.Install(nodes.Get(0), nodes.Get(1));
+
+  InternetStackHelper stack;
+  stack.Install(senders);
+  stack.Install(nodes);
+
+  // =========================== TBF QueueDisc ==========================
+  TrafficControlHelper tch;
+  tch.SetRootQueueDisc(getQueueDiscType(), "MaxSize",
+                       QueueSizeValue(QueueSize(queueSize)), "Burst",
+                       UintegerValue(burst), "Mtu", UintegerValue(mtu), "Rate",
+                       DataRateValue(DataRate(rate)), "PeakRate",
+                       DataRateValue(DataRate(peakRate)));
+  QueueDiscContainer qdiscs = tch.Install(bottleneckDevices.Get(0));
+  Ptr<QueueDisc> q = qdiscs.Get(0);
+  q->TraceConnectWithoutContext("Drop", MakeCallback(&PacketDropCallback));
+
+  //   10.1.1.x on n_r <-> n_d, 10.4.x.x one /30 per access link
+  Ipv4AddressHelper accessAddress, bottleneckAddress;
+  accessAddress.SetBase("10.4.0.0", "255.255.255.252");
+  bottleneckAddress.SetBase("10.1.1.0", "255.255.255.0");
+
+  Ipv4StaticRoutingHelper staticRouting;
+  for (uint32_t i = 0; i < flowCount; i++) {
+    Ipv4InterfaceContainer ifaces = accessAddress.Assign(accessDevices[i]);
+    accessAddress.NewNetwork();
+    staticRouting.GetStaticRouting(senders.Get(i)->GetObject<Ipv4>())
+        ->SetDefaultRoute(ifaces.GetAddress(1), 1);
+  }
+  Ipv4InterfaceContainer bottleneckIfaces =
+      bottleneckAddress.Assign(bottleneckDevices);
+  staticRouting.GetStaticRouting(nodes.Get(1)->GetObject<Ipv4>())
+      ->SetDefaultRoute(bottleneckIfaces.GetAddress(0), 1);
+
+  // “Rx” will fire when IP receives a packet from the traffic-control layer
+  nodes.Get(1)->GetObject<Ipv4>()->TraceConnectWithoutContext(
+      "Rx", MakeCallback(&Ipv4RxTrace));
+
+  Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(payloadSize));
+
+  // flow 0 starts at simStart, the others spread over startSpread seconds
+  // so that their slow starts do not all hit the TBF at once
+  Ptr<UniformRandomVariable> startVar = CreateObject<UniformRandomVariable>();
+  startVar->SetAttribute("Min", DoubleValue(simStart));
+  startVar->SetAttribute("Max", DoubleValue(simStart + startSpread));
+
+  Ptr<ComplexSendApplication> measurementApp;
+  for (uint32_t i = 0; i < flowCount; i++) {
+    uint16_t port = BASE_PORT + i;
+    PacketSinkHelper sinkHelper(
+        "ns3::TcpSocketFactory",
+        InetSocketAddress(Ipv4Address::GetAny(), port));
+    ApplicationContainer sinkApp = sinkHelper.Install(nodes.Get(1));
+    sinkApp.Start(Seconds(0.0));
+    sinkApp.Stop(Seconds(simulationTime));
+
+    Ptr<ComplexSendApplication> app = CreateObject<ComplexSendApplication>();
+    app->SetAttribute("Remote", AddressValue(InetSocketAddress(
+                                    bottleneckIfaces.GetAddress(1), port)));
+    app->SetAttribute("MaxBytes",
+                      UintegerValue(0)); // 0 means send indefinitely
+    app->SetAttribute("MinSend", UintegerValue(MIN_SEND_RATE));
+    app->SetAttribute("MaxSend", UintegerValue(MAX_SEND_RATE));
+    senders.Get(i)->AddApplication(app);
+    app->SetStartTime(Seconds(i == 0 ? simStart : startVar->GetValue()));
+    app->SetStopTime(Seconds(simEnd));
+    if (i == 0)
+      measurementApp = app;
+  }
+
+  Simulator::Schedule(
+      Seconds(simStart + 1e-7), // a bit after StartApplication()
+      MakeBoundCallback(&ConnectCwndTrace, measurementApp));
+
+  assignFiles(pointToPointAccess, pointToPointBottleneck,
+              accessDevices[0].Get(0), bottleneckDevices.Get(1),
+              sim_name_full, args);
+
+  getTracerFiles(sim_name_full, args, cwndFile, rttFile, rtoFile);
+  getTokensFile(q, sim_name_full, args, tokensFile);
+  droppedPacketsFile.open(getDroppedPacketsFileName(sim_name_full, args));
+
+  Simulator::Stop(Seconds(simulationTime + 5));
+  double wallTime = runAndPrintCost();
+  double simulatedTime = Simulator::Now().GetSeconds();
+  Simulator::Destroy();
+
+  cwndFile.Close();
+  rttFile.Close();
+  rtoFile.Close();
+  tokensFile.Close();
+  droppedPacketsFile.close();
+  closeEventLogs();
+
+  double throughput = flows.GetDeliveredBytes(0) * 8 / simulationTime;
+  double aggregateThroughput = flows.GetTotalBytes() * 8 / simulationTime;
+
+  std::cout << std::endl << "*** Throughput Statistics ***" << std::endl;
+  std::cout << "Flows: " << flowCount << std::endl;
+  std::cout << "Measurement flow: " << throughput / 1e6 << " Mbps"
+            << std::endl;
+  std::cout << "Aggregate: " << aggregateThroughput / 1e6 << " Mbps, "
+            << flows.GetTotalLosses() << " losses" << std::endl;
+  std::cout << "Fairness: " << flows.GetFairness() << std::endl;
+  std::cout << "Wall time per simulated second: " << wallTime / simulatedTime
+            << " s" << std::endl;
+
+  std::cout << std::endl << "*** TC Layer statistics ***" << std::endl;
+  std::cout << q->GetStats() << std::endl;
+
+  flows.WriteCsv(getFilename("flows", sim_name_full, args));
+
+  const GoogleRateEstimator &google = estimators.GetGoogle();
+  std::ofstream metadata(getMetadataFileName(sim_name_full, args));
+  metadata << throughput << std::endl;  // Log throughput in bps
+  metadata << google.GetLossCount()
+           << std::endl; // Log number of dropped packets
+  estimators.WriteMetadata(metadata);
+  flows.WriteMetadata(metadata);
+  metadata << "aggregate_rate=" << aggregateThroughput << std::endl;
+  metadata << "wall_time=" << wallTime << std::endl;
+  metadata << "simulated_time=" << simulatedTime << std::endl;
+  metadata.close();
+
+  ResultRecord result = getResultRecord(SIM_NAME, sim_name_full, args);
+  result.SetParameter("burst", burst);
+  result.SetParameter("queueSize", queueSize);
+  result.SetParameter("mtu", mtu);
+  result.SetParameter("rate", rate.GetBitRate());
+  result.SetParameter("peakRate", peakRate.GetBitRate());
+  result.SetParameter("flows", flowCount);
+  result.SetParameter("accessRate", accessRate.GetBitRate());
+  result.SetParameter("startSpread", startSpread);
+  result.SetParameter("reno", reno);
+  result.ReadMetadata(getMetadataFileName(sim_name_full, args));
+  appendResult(result);
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t flowCount = 100;
+  uint32_t burst = 500000;
+  uint32_t mtu = 0; // second bucket is disabled
+  DataRate rate = DataRate("20Mbps");
+  DataRate peakRate = DataRate("0bps");
+  DataRate accessRate = DataRate("100Mbps");
+  double simulationTime = 11.1; // seconds
+  double startSpread = 1.0;
+
+  Config::SetDefault("ns3::TcpSocket::SndBufSize", UintegerValue(500000));
+  Config::SetDefault("ns3::TcpSocket::RcvBufSize", UintegerValue(500000));
+
+  std::string queueSize = "100p";
+
+  uint32_t reno = 0;
+
+  CommandLine cmd(__FILE__);
+  cmd.AddValue("flows", "Number of senders sharing the TBF", flowCount);
+  cmd.AddValue("burst", "Size of first bucket in bytes", burst);
+  cmd.AddValue("mtu", "Size of second bucket in bytes", mtu);
+  cmd.AddValue("rate", "Rate of tokens arriving in first bucket", rate);
+  cmd.AddValue("peakRate", "Rate of tokens arriving in second bucket",
+               peakRate);
+  cmd.AddValue("queueSize",
+               "Amount of bytes or packets that can be stored in the bucket "
+               "instead of dropping the packet. Queue size in bytes or packets",
+               queueSize);
+  cmd.AddValue("accessRate", "Rate of every sender's access link",
+               accessRate);
+  cmd.AddValue("simulationTime", "Seconds until the receivers stop",
+               simulationTime);
+  cmd.AddValue("startSpread",
+               "Senders other than the measurement flow start at random "
+               "within this many seconds",
+               startSpread);
+  cmd.AddValue("reno",
+               "Set to use TCP Reno instead of Cubic (default is Cubic)", reno);
+
+  cmd.Parse(argc, argv);
+  // --LinkRate, when given, takes precedence over --accessRate
+  accessRate = getLinkRate(accessRate);
+
+  if (flowCount == 0 || flowCount > 65535 - BASE_PORT)
+    NS_FATAL_ERROR("flows must be between 1 and " << 65535 - BASE_PORT);
+
+  if (reno) {
+    Config::SetDefault("ns3::TcpL4Protocol::SocketType",
+                       TypeIdValue(TcpNewReno::GetTypeId()));
+    std::cout << "Using TCP Reno" << std::endl;
+  }
+
+  setBaseConfigHash(argc, argv, {});
+
+  RunSimulation(flowCount, burst, queueSize, mtu, rate, peakRate, accessRate,
+                simulationTime, startSpread, reno);
+  return 0;
+}
@@ -19,6 +19,7 @@
 #include "ns3/traffic-control-module.h"
 #include "ns3/tcp-header.h"
 #include "custom-send-application.h"
+#include "utils.h"
 
 #include <fstream> // store throughput data
 #include <vector>
@@ -82,7 +83,7 @@ Ipv4RxTrace (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
 // }
 
 
-std::ofstream droppedPacketsFile("wehe-dropped-packets.txt");
+static std::ofstream droppedPacketsFile;
 
 void
 PacketDropCallback (Ptr<const QueueDiscItem> item)
@@ -140,12 +141,14 @@ int main(int argc, char *argv[]) {
   NodeContainer nodes;
   nodes.Create(3);
 
+  DataRate linkRate = getLinkRate(DataRate("20Mb/s"));
+
   PointToPointHelper pointToPoint1;
-  pointToPoint1.SetDeviceAttribute("DataRate", StringValue("20Mb/s")); // link bandwidth
+  pointToPoint1.SetDeviceAttribute("DataRate", DataRateValue(linkRate)); // link bandwidth
   pointToPoint1.SetChannelAttribute("Delay", StringValue("0ms"));
 
   PointToPointHelper pointToPoint2;
-  pointToPoint2.SetDeviceAttribute("DataRate", StringValue("20Mb/s")); // link bandwidth
+  pointToPoint2.SetDeviceAttribute("DataRate", DataRateValue(linkRate)); // link bandwidth
   pointToPoint2.SetChannelAttribute("Delay", StringValue("0ms"));
 
   NetDeviceContainer devices1 = pointToPoint1.Install(nodes.Get(0), nodes.Get(1));
@@ -242,14 +245,18 @@ int main(int argc, char *argv[]) {
   //           << std::endl;
   // std::cout << "Throughput: " << throughput / 1e6 << " Mbps" << std::endl;
   
+  std::vector<std::string> args;
+  std::string traceFileNameBase = getFilename ("sim", "custom-send", args);
+
   AsciiTraceHelper ascii;
-  pointToPoint1.EnableAsciiAll (ascii.CreateFileStream ("wehe_sim_n0-n1.tr"));
-  pointToPoint2.EnableAsciiAll (ascii.CreateFileStream ("wehe_sim_n1-n2.tr"));
-  pointToPoint1.EnablePcapAll ("wehe_n0-n1");
-  pointToPoint2.EnablePcapAll ("wehe_n1-n2");
+  pointToPoint1.EnableAsciiAll (ascii.CreateFileStream (traceFileNameBase + "n0-n1.tr"));
+  pointToPoint2.EnableAsciiAll (ascii.CreateFileStream (traceFileNameBase + "n1-n2.tr"));
+  pointToPoint1.EnablePcapAll (traceFileNameBase + "n0-n1");
+  pointToPoint2.EnablePcapAll (traceFileNameBase + "n1-n2");
+  droppedPacketsFile.open (getDroppedPacketsFileName ("custom-send", args));
 
   Simulator::Stop(Seconds(simulationTime + 5));
-  Simulator::Run();
+  runAndPrintCost();
 
   Simulator::Destroy();
 
@@ -6,7 +6,8 @@
 CustomIndexedSender::CustomIndexedSender ()
 : m_socket (0),
   m_totBytes (0),
-  m_packetIndex (1)
+  m_packetIndex (1),
+  m_connected (false)
 {
 }
 
@@ -46,44 +47,66 @@ TypeId CustomIndexedSender::GetTypeId (void)
 
   void CustomIndexedSender::SendData ()
   {
-    if (Simulator::Now() >= m_stopTime)
+    // Sends until the socket buffer is full; DataSend calls back in once
+    // the socket has room again, so no event is scheduled per packet
+    while (m_connected)
       {
-        std::cout << "More than stop time" << std::endl;
+        if (Simulator::Now() >= m_stopTime)
+          {
+            std::cout << "More than stop time" << std::endl;
 
-        return;
+            return;
+          }
+
+        if (m_maxBytes > 0 && m_totBytes >= m_maxBytes)
+          {
+            return; // finished sending the specified amount of data
+          }
+
+        uint32_t sendSize = m_sendSize;
+        // If a max bytes limit is set, adjust the send size accordingly.
+        if (m_maxBytes > 0 && (m_totBytes + sendSize) > m_maxBytes)
+          {
+            sendSize = m_maxBytes - m_totBytes;
+          }
+
+        if (m_socket->GetTxAvailable () < sendSize)
+          {
+            return;
+          }
+
+        PatchIndex (sendSize);
+        Ptr<Packet> packet = Create<Packet> (m_payload.data (), sendSize);
+        int actual = m_socket->Send (packet);
+        // NS_LOG_INFO ("Sent packet " << m_packetIndex << " (" << actual << " bytes)");
+        if (actual <= 0)
+          {
+            return; // not sent, the same index goes into the next attempt
+          }
+        m_totBytes += actual;
+        m_packetIndex++;
       }
+  }
 
-    if (m_maxBytes > 0 && m_totBytes >= m_maxBytes)
+  void CustomIndexedSender::PatchIndex (uint32_t sendSize)
+  {
+    // Same bytes as copying std::to_string (m_packetIndex) over a zeroed
+    // buffer: the index only grows, so its digits cover the previous ones
+    char digits[10];
+    uint32_t length = 0;
+    uint32_t index = m_packetIndex;
+    do
       {
-        return; // finished sending the specified amount of data
+        digits[length++] = '0' + index % 10;
+        index /= 10;
       }
+    while (index > 0);
 
-    uint32_t sendSize = m_sendSize;
-    // If a max bytes limit is set, adjust the send size accordingly.
-    if (m_maxBytes > 0 && (m_totBytes + sendSize) > m_maxBytes)
+    length = std::min (length, sendSize);
+    for (uint32_t i = 0; i < length; i++)
       {
-        sendSize = m_maxBytes - m_totBytes;
+        m_payload[i] = digits[length - 1 - i];
       }
-    
-    // Create a buffer of fixed size and initialize it with zeros.
-    std::vector<uint8_t> buffer(sendSize, 0);
-
-    // Convert the current packet index into a string.
-    std::string indexStr = std::to_string(m_packetIndex);
-    // You might want to pad the string to a fixed width or insert a delimiter if needed.
-    // Here we simply copy it into the beginning of the buffer.
-    std::copy(indexStr.begin(), indexStr.end(), buffer.begin());
-
-    // Create a packet from the buffer.
-    Ptr<Packet> packet = Create<Packet> (buffer.data(), sendSize);
-    int actual = m_socket->Send (packet);
-    // NS_LOG_INFO ("Sent packet " << m_packetIndex << " (" << actual << " bytes)");
-    // std::cout << "Sent packet " << m_packetIndex << " (" << actual << " bytes)" << std::endl;
-    m_totBytes += actual;
-    m_packetIndex++;
-
-    // Schedule the next packet send (here we do it immediately; you can add a delay as needed)
-    m_sendEvent = Simulator::Schedule (Seconds (0.0001), &CustomIndexedSender::SendData, this);
   }
 
   void CustomIndexedSender::StartApplication (void)
@@ -91,15 +114,41 @@ TypeId CustomIndexedSender::GetTypeId (void)
     // Create and connect the socket.
     if (!m_socket)
       {
+        m_payload.assign (m_sendSize, 0);
+
         m_socket = Socket::CreateSocket (GetNode (), TypeId::LookupByName ("ns3::TcpSocketFactory"));
+        m_socket->SetConnectCallback (
+          MakeCallback (&CustomIndexedSender::ConnectionSucceeded, this),
+          MakeCallback (&CustomIndexedSender::ConnectionFailed, this));
+        m_socket->SetSendCallback (MakeCallback (&CustomIndexedSender::DataSend, this));
         m_socket->Connect (m_peer);
       }
     SendData ();
   }
 
+  void CustomIndexedSender::ConnectionSucceeded (Ptr<Socket> socket)
+  {
+    m_connected = true;
+    SendData ();
+  }
+
+  void CustomIndexedSender::ConnectionFailed (Ptr<Socket> socket)
+  {
+    std::cout << "CustomIndexedSender could not connect" << std::endl;
+  }
+
+  void CustomIndexedSender::DataSend (Ptr<Socket> socket, uint32_t available)
+  {
+    if (m_connected && m_sendEvent.IsExpired ())
+      {
+        m_sendEvent = Simulator::ScheduleNow (&CustomIndexedSender::SendData, this);
+      }
+  }
+
   void CustomIndexedSender::StopApplication (void)
   {
     std::cout << "Stop application called" << std::endl;
+    m_connected = false;
     if (m_socket)
       {
         m_socket->Close ();
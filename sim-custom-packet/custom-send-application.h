@@ -27,6 +27,13 @@ protected:
   virtual void StopApplication (void);
 
 private:
+  void ConnectionSucceeded (Ptr<Socket> socket);
+  void ConnectionFailed (Ptr<Socket> socket);
+  void DataSend (Ptr<Socket> socket, uint32_t available); // SetSendCallback
+
+  // Writes the decimal packet index over the start of m_payload
+  void PatchIndex (uint32_t sendSize);
+
   Ptr<Socket> m_socket;
   Address m_peer;
   uint32_t m_sendSize;  // size of each packet (e.g., 1448 bytes)
@@ -35,4 +42,6 @@ private:
   EventId m_sendEvent;
   uint32_t m_packetIndex;  // counter to embed into the payload
   Time m_stopTime;         // stores the stop time set via attribute
+  bool m_connected;
+  std::vector<uint8_t> m_payload;  // zero-filled template, index patched in place
 };
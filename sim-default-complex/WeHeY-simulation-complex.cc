@@ -76,7 +76,7 @@ static void Ipv4RxTrace(Ptr<const Packet> packet, Ptr<Ipv4> ipv4,
     sumRxBytes += packet->GetSize();
 }
 
-std::ofstream droppedPacketsFile("wehe-dropped-packets.txt");
+static std::ofstream droppedPacketsFile;
 
 void PacketDropCallback(Ptr<const QueueDiscItem> item) {
   double dropSeconds = Simulator::Now().GetSeconds();
@@ -138,14 +138,16 @@ int main(int argc, char *argv[]) {
   NodeContainer nodes;
   nodes.Create(3);
 
+  DataRate linkRate = getLinkRate(DataRate("20Mb/s"));
+
   PointToPointHelper pointToPoint1;
   pointToPoint1.SetDeviceAttribute("DataRate",
-                                   StringValue("20Mb/s")); // link bandwidth
+                                   DataRateValue(linkRate)); // link bandwidth
   pointToPoint1.SetChannelAttribute("Delay", StringValue("0ms"));
 
   PointToPointHelper pointToPoint2;
   pointToPoint2.SetDeviceAttribute("DataRate",
-                                   StringValue("20Mb/s")); // link bandwidth
+                                   DataRateValue(linkRate)); // link bandwidth
   pointToPoint2.SetChannelAttribute("Delay", StringValue("0ms"));
 
   NetDeviceContainer devices1 =
@@ -230,14 +232,16 @@ int main(int argc, char *argv[]) {
   std::vector<std::string> args;
   // args.push_back(std::to_string(burst));
   // args.push_back(queueSize);
-  assignFiles(pointToPoint1, pointToPoint2, "complex", args);
+  assignFiles(pointToPoint1, pointToPoint2, devices1.Get(0), devices2.Get(1),
+              "complex", args);
+  droppedPacketsFile.open(getDroppedPacketsFileName("complex", args));
 
   Ptr<PacketSink> sink = DynamicCast<PacketSink>(sinkApp.Get(0));
   // double interval = 0.1; // Check throughput every 0.001 seconds
   // Simulator::Schedule(Seconds(interval), &ThroughputMonitor, sink, interval);
 
   Simulator::Stop(Seconds(simulationTime));
-  Simulator::Run();
+  runAndPrintCost();
 
   Simulator::Destroy();
 
@@ -81,7 +81,7 @@ Ipv4RxTrace (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
 // }
 
 
-std::ofstream droppedPacketsFile("wehe-dropped-packets.txt");
+static std::ofstream droppedPacketsFile;
 
 void
 PacketDropCallback (Ptr<const QueueDiscItem> item)
@@ -139,12 +139,14 @@ int main(int argc, char *argv[]) {
   NodeContainer nodes;
   nodes.Create(3);
 
+  DataRate linkRate = getLinkRate(DataRate("20Mb/s"));
+
   PointToPointHelper pointToPoint1;
-  pointToPoint1.SetDeviceAttribute("DataRate", StringValue("20Mb/s")); // link bandwidth
+  pointToPoint1.SetDeviceAttribute("DataRate", DataRateValue(linkRate)); // link bandwidth
   pointToPoint1.SetChannelAttribute("Delay", StringValue("0ms"));
 
   PointToPointHelper pointToPoint2;
-  pointToPoint2.SetDeviceAttribute("DataRate", StringValue("20Mb/s")); // link bandwidth
+  pointToPoint2.SetDeviceAttribute("DataRate", DataRateValue(linkRate)); // link bandwidth
   pointToPoint2.SetChannelAttribute("Delay", StringValue("0ms"));
 
   NetDeviceContainer devices1 = pointToPoint1.Install(nodes.Get(0), nodes.Get(1));
@@ -237,10 +239,12 @@ int main(int argc, char *argv[]) {
   std::vector<std::string> args;
   // args.push_back(std::to_string(burst));
   // args.push_back(queueSize);
-  assignFiles(pointToPoint1, pointToPoint2, "default", args);
+  assignFiles(pointToPoint1, pointToPoint2, devices1.Get(0), devices2.Get(1),
+              "default", args);
+  droppedPacketsFile.open(getDroppedPacketsFileName("default", args));
 
   Simulator::Stop(Seconds(simulationTime + 5));
-  Simulator::Run();
+  runAndPrintCost();
 
   Simulator::Destroy();
 
@@ -20,6 +20,9 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/tcp-header.h"
 #include "ns3/traffic-control-module.h"
+#include "drain-detector.h"
+#include "fast-forward.h"
+#include "rate-estimator.h"
 #include "utils.h"
 
 #include <fstream> // store throughput data
@@ -53,20 +56,23 @@ static uint32_t g_ipTxCount = 0;
 static uint32_t g_ipRxCount = 0;
 static uint32_t g_ipRxTotal = 0;
 
-static uint32_t sumRxBytes = 0;
-static double t_firstLoss = -1.0;
-static double t_lastLoss = -1.0;
+static RateEstimators estimators;
+static ConvergenceMonitor convergence;
+static DrainDetector drainDetector;
+
+// Time of the loss at which --FastForward=1 stopped the packet simulation
+static SawtoothFastForward fastForward;
+static double g_fastForwardStart = -1.0;
 
 static const uint32_t MIN_SEND_RATE = 1;
 static const uint32_t MAX_SEND_RATE = 1448;
 
 static const std::string SIM_NAME = "complex-shaping";
 
-static std::vector<uint32_t> sums;
-
-static std::ofstream cwndFile;
-static std::ofstream rttFile;
-static std::ofstream rtoFile;
+static TraceSink cwndFile;
+static TraceSink rttFile;
+static TraceSink rtoFile;
+static TraceSink tokensFile;
 
 static void Ipv4RxTrace(Ptr<const Packet> packet, Ptr<Ipv4> ipv4,
                         uint32_t interface) {
@@ -74,22 +80,29 @@ static void Ipv4RxTrace(Ptr<const Packet> packet, Ptr<Ipv4> ipv4,
   // std::cout << "received: " << packet->GetSize() << std::endl;
   g_ipRxCount++;
   g_ipRxTotal += packet->GetSize();
-  if (t_firstLoss > 0)
-    sumRxBytes += packet->GetSize();
+  estimators.PacketDelivered(Simulator::Now().GetSeconds(), packet->GetSize());
+  if (convergence.PacketDelivered(Simulator::Now().GetSeconds()))
+    Simulator::Stop();
+  fastForward.PacketDelivered(Simulator::Now().GetSeconds(),
+                              packet->GetSize());
 }
 
 static void CwndTracer(uint32_t oldCwnd, uint32_t newCwnd) {
-  cwndFile << Simulator::Now().GetSeconds() << "," << newCwnd << std::endl;
+  estimators.CwndChanged(Simulator::Now().GetSeconds(), newCwnd);
+  fastForward.CwndChanged(Simulator::Now().GetSeconds(), newCwnd);
+  cwndFile.Write(Simulator::Now().GetSeconds(), newCwnd);
 }
 
 static void RttTracer(Time oldRtt, Time newRtt) {
-  rttFile << Simulator::Now().GetSeconds() << "," << newRtt.GetSeconds()
-          << std::endl;
+  estimators.RttChanged(Simulator::Now().GetSeconds(), newRtt.GetSeconds());
+  fastForward.RttChanged(Simulator::Now().GetSeconds(), newRtt.GetSeconds());
+  rttFile.Write(Simulator::Now().GetSeconds(), newRtt.GetSeconds());
 }
 
 static void RtoTracer(Time oldRto, Time newRto) {
-  rtoFile << Simulator::Now().GetSeconds() << "," << newRto.GetSeconds()
-          << std::endl;
+  estimators.RtoChanged(Simulator::Now().GetSeconds(), newRto.GetSeconds());
+  fastForward.RtoChanged(Simulator::Now().GetSeconds(), newRto.GetSeconds());
+  rtoFile.Write(Simulator::Now().GetSeconds(), newRto.GetSeconds());
 }
 
 void ConnectCwndTrace(Ptr<ComplexSendApplication> app) {
@@ -104,15 +117,20 @@ void ConnectCwndTrace(Ptr<ComplexSendApplication> app) {
     NS_LOG_ERROR("Socket still null at connect time");
 }
 
-std::ofstream droppedPacketsFile("wehe-dropped-packets.txt");
+static std::ofstream droppedPacketsFile;
 
 void PacketDropCallback(Ptr<const QueueDiscItem> item) {
   double dropSeconds = Simulator::Now().GetSeconds();
 
-  if (t_firstLoss < 0)
-    t_firstLoss = dropSeconds;
-  t_lastLoss = dropSeconds;
-  sums.push_back(sumRxBytes);
+  estimators.PacketLost(dropSeconds);
+  if (convergence.PacketLost(dropSeconds, estimators.GetGoogle().GetRate()))
+    Simulator::Stop();
+  if (fastForward.PacketLost(dropSeconds) && g_fastForwardStart < 0 &&
+      !convergence.IsStopped() && getFastForward()) {
+    // the rest of the flow repeats the last cycle, see fast-forward.h
+    g_fastForwardStart = dropSeconds;
+    Simulator::Stop();
+  }
 
   TcpHeader tcpHeader;
   Ptr<const Packet> packet = item->GetPacket();
@@ -124,59 +142,63 @@ void PacketDropCallback(Ptr<const QueueDiscItem> item) {
     droppedPacketsFile << dropSeconds << ",," << packet->GetSize() << std::endl;
 }
 
-int main(int argc, char *argv[]) {
-  double simulationTime = 11.1; // seconds
-  double simStart = 0.1;
-  double simEnd = simulationTime - 1;
-
-  uint32_t payloadSize = 1448; // bytes
-  uint32_t burst = 500000;
-  uint32_t mtu = 0; // second bucket is disabled
-  DataRate rate = DataRate("2Mbps");
-  DataRate peakRate = DataRate("0bps");
-
-  Config::SetDefault("ns3::TcpSocket::SndBufSize", UintegerValue(500000));
-  Config::SetDefault("ns3::TcpSocket::RcvBufSize", UintegerValue(500000));
+// Clears the per-run counters and trace files so that the next point of an
+// in-process sweep starts from the same state as a fresh process.
+static void ResetRunState() {
+  g_ipTxCount = 0;
+  g_ipRxCount = 0;
+  g_ipRxTotal = 0;
+  estimators.Reset();
+  convergence.Reset();
+  drainDetector.Reset();
+  fastForward.Reset();
+  g_fastForwardStart = -1.0;
+
+  cwndFile.Close();
+  rttFile.Close();
+  rtoFile.Close();
+  tokensFile.Close();
+  droppedPacketsFile.close();
+  closeEventLogs();
 
-  std::string queueSize = "100p";
+  // Addresses and random streams are process-wide, not owned by the simulator
+  Ipv4AddressGenerator::Reset();
+  RngSeedManager::ResetNextStreamIndex();
+}
 
-  std::string sim_name_full = SIM_NAME;
+static void RunSimulation(uint32_t burst, std::string queueSize, uint32_t mtu,
+                          DataRate rate, DataRate peakRate,
+                          std::string sim_name_full) {
+  std::vector<std::string> args;
+  args.push_back(std::to_string(burst));
+  args.push_back(queueSize);
+  if (isCompleted(getConfigHash(sim_name_full, args))) {
+    std::cout << "Skipping burst " << burst << ", queueSize " << queueSize
+              << ": already in the result store" << std::endl;
+    return;
+  }
 
-  uint32_t reno = 0;
+  configureConvergence(convergence);
 
-  CommandLine cmd(__FILE__);
-  cmd.AddValue("burst", "Size of first bucket in bytes", burst);
-  cmd.AddValue("mtu", "Size of second bucket in bytes", mtu);
-  cmd.AddValue("rate", "Rate of tokens arriving in first bucket", rate);
-  cmd.AddValue("peakRate", "Rate of tokens arriving in second bucket",
-               peakRate);
-  cmd.AddValue("queueSize",
-               "Amount of bytes or packets that can be stored in the bucket "
-               "instead of dropping the packet. Queue size in bytes or packets",
-               queueSize);
-  cmd.AddValue("reno",
-               "Set to use TCP Reno instead of Cubic (default is Cubic)", reno);
-
-  cmd.Parse(argc, argv);
+  double simulationTime = 11.1; // seconds
+  double simStart = 0.1;
+  double simEnd = simulationTime - 1;
 
-  if (reno) {
-    Config::SetDefault("ns3::TcpL4Protocol::SocketType",
-                       TypeIdValue(TcpNewReno::GetTypeId()));
-    std::cout << "Using TCP Reno" << std::endl;
-    sim_name_full = "reno-" + SIM_NAME;
-  }
+  uint32_t payloadSize = 1448; // bytes
 
   NodeContainer nodes;
   nodes.Create(3);
 
+  DataRate linkRate = getLinkRate(DataRate("200Mb/s"));
+
   PointToPointHelper pointToPoint1;
   pointToPoint1.SetDeviceAttribute("DataRate",
-                                   StringValue("200Mb/s")); // link bandwidth
+                                   DataRateValue(linkRate)); // link bandwidth
   pointToPoint1.SetChannelAttribute("Delay", StringValue("5ms"));
 
   PointToPointHelper pointToPoint2;
   pointToPoint2.SetDeviceAttribute("DataRate",
-                                   StringValue("200Mb/s")); // link bandwidth
+                                   DataRateValue(linkRate)); // link bandwidth
   pointToPoint2.SetChannelAttribute("Delay", StringValue("5ms"));
 
   NetDeviceContainer devices1 =
@@ -189,7 +211,7 @@ int main(int argc, char *argv[]) {
 
   TrafficControlHelper tch;
   tch.SetRootQueueDisc(
-      "ns3::TbfQueueDisc", "MaxSize",
+      getQueueDiscType(), "MaxSize",
       QueueSizeValue(
           QueueSize(queueSize)), // Try BDP or limiting layer rate delay product
                                  // = Rate * RTT (change RTT to )
@@ -257,27 +279,43 @@ int main(int argc, char *argv[]) {
       Seconds(simStart + 1e-7), // a bit after StartApplication()
       MakeBoundCallback(&ConnectCwndTrace, app));
 
-  std::vector<std::string> args;
-  args.push_back(std::to_string(burst));
-  args.push_back(queueSize);
   assignFiles(pointToPoint1, pointToPoint2, devices1.Get(0), devices2.Get(1),
               sim_name_full, args);
 
   Ptr<PacketSink> sink = DynamicCast<PacketSink>(sinkApp.Get(0));
 
   getTracerFiles(sim_name_full, args, cwndFile, rttFile, rtoFile);
+  getTokensFile(q, sim_name_full, args, tokensFile);
+  droppedPacketsFile.open(getDroppedPacketsFileName(sim_name_full, args));
   Simulator::Stop(Seconds(simulationTime + 5));
-  Simulator::Run();
+  if (getDrainDetection())
+    drainDetector.Schedule(Seconds(simulationTime + 5));
+  runAndPrintCost();
   Simulator::Destroy();
 
+  if (g_fastForwardStart >= 0) {
+    fastForward.FastForward(g_fastForwardStart, simEnd, estimators);
+    g_ipRxCount += fastForward.GetForwardedPackets();
+    g_ipRxTotal += fastForward.GetForwardedBytes();
+    std::cout << "Fast-forwarded from " << g_fastForwardStart << " s to "
+              << simEnd << " s" << std::endl;
+  }
+
   double totalBytesReceived = g_ipRxTotal; // Get total received bytes
+  // a run stopped early only delivered up to its stop time
+  double runTime =
+      convergence.IsStopped() ? convergence.GetStopTime() : simulationTime;
   double throughput =
-      (totalBytesReceived * 8) / simulationTime; // Convert to bits per second
+      (totalBytesReceived * 8) / runTime; // Convert to bits per second
 
   std::cout << std::endl << "*** Throughput Statistics ***" << std::endl;
   std::cout << "Total Bytes Received: " << totalBytesReceived << " bytes"
             << std::endl;
   std::cout << "Throughput: " << throughput / 1e6 << " Mbps" << std::endl;
+  if (drainDetector.IsDrained())
+    std::cout << "Drained at " << drainDetector.GetDrainTime() << " s, "
+              << drainDetector.GetSavedTime() << " s not simulated"
+              << std::endl;
 
   // throughputFile.close();
   droppedPacketsFile.close();
@@ -290,23 +328,102 @@ int main(int argc, char *argv[]) {
   std::cout << "IP-layer Rx Count (after queue disc):  " << g_ipRxCount
             << std::endl;
 
+  const GoogleRateEstimator &google = estimators.GetGoogle();
   std::ofstream metadata(getMetadataFileName(sim_name_full, args));
   metadata << throughput << std::endl;  // Log throughput in bps
-  metadata << sums.size() << std::endl; // Log number of dropped packets
+  metadata << google.GetLossCount()
+           << std::endl; // Log number of dropped packets
+  estimators.WriteMetadata(metadata);
+  convergence.WriteMetadata(metadata);
+  drainDetector.WriteMetadata(metadata);
+  fastForward.WriteMetadata(metadata);
   metadata.close();
 
-  if (!sums.empty()) {
+  ResultRecord result = getResultRecord(SIM_NAME, sim_name_full, args);
+  result.SetParameter("burst", burst);
+  result.SetParameter("queueSize", queueSize);
+  result.SetParameter("mtu", mtu);
+  result.SetParameter("rate", rate.GetBitRate());
+  result.SetParameter("peakRate", peakRate.GetBitRate());
+  result.SetParameter("reno", sim_name_full != SIM_NAME);
+  result.ReadMetadata(getMetadataFileName(sim_name_full, args));
+  appendResult(result);
+
+  if (google.GetLossCount() > 0) {
     std::cout << std::endl << "*** Google paper estimation ***" << std::endl;
     std::cout << "Time between first and last loss: "
-              << t_lastLoss - t_firstLoss << std::endl;
-    std::cout << "The number of sums: " << sums.size() << std::endl;
+              << google.GetLastLossTime() - google.GetFirstLossTime()
+              << std::endl;
+    std::cout << "The number of losses: " << google.GetLossCount()
+              << std::endl;
     std::cout << "Bytes received in between first and last loss: "
-              << sums[sums.size() - 1] << std::endl;
-    std::cout << "Estimated goodput: "
-              << sums[sums.size() - 1] / (t_lastLoss - t_firstLoss)
-              << " B/s\t -> "
-              << sums[sums.size() - 1] / (t_lastLoss - t_firstLoss) * 8
-              << " b/s" << std::endl;
+              << google.GetDeliveredBytes() << std::endl;
+    std::cout << "Estimated goodput: " << google.GetRate() / 8 << " B/s\t -> "
+              << google.GetRate() << " b/s" << std::endl;
+  }
+
+  ResetRunState();
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t burst = 500000;
+  uint32_t mtu = 0; // second bucket is disabled
+  DataRate rate = DataRate("2Mbps");
+  DataRate peakRate = DataRate("0bps");
+
+  Config::SetDefault("ns3::TcpSocket::SndBufSize", UintegerValue(500000));
+  Config::SetDefault("ns3::TcpSocket::RcvBufSize", UintegerValue(500000));
+
+  std::string queueSize = "100p";
+
+  std::string sim_name_full = SIM_NAME;
+
+  uint32_t reno = 0;
+
+  std::string sweepFile = "";
+
+  CommandLine cmd(__FILE__);
+  cmd.AddValue("burst", "Size of first bucket in bytes", burst);
+  cmd.AddValue("mtu", "Size of second bucket in bytes", mtu);
+  cmd.AddValue("rate", "Rate of tokens arriving in first bucket", rate);
+  cmd.AddValue("peakRate", "Rate of tokens arriving in second bucket",
+               peakRate);
+  cmd.AddValue("queueSize",
+               "Amount of bytes or packets that can be stored in the bucket "
+               "instead of dropping the packet. Queue size in bytes or packets",
+               queueSize);
+  cmd.AddValue("reno",
+               "Set to use TCP Reno instead of Cubic (default is Cubic)", reno);
+  cmd.AddValue("sweep",
+               "File with one burst,queueSize point per line. All points are "
+               "run in this process instead of burst and queueSize",
+               sweepFile);
+
+  cmd.Parse(argc, argv);
+
+  if (reno) {
+    Config::SetDefault("ns3::TcpL4Protocol::SocketType",
+                       TypeIdValue(TcpNewReno::GetTypeId()));
+    std::cout << "Using TCP Reno" << std::endl;
+    sim_name_full = "reno-" + SIM_NAME;
+  }
+
+  setBaseConfigHash(argc, argv, {"burst", "queueSize", "sweep"});
+
+  if (sweepFile.empty()) {
+    RunSimulation(burst, queueSize, mtu, rate, peakRate, sim_name_full);
+    return 0;
+  }
+
+  std::vector<SweepPoint> points = readSweepPoints(sweepFile);
+  for (size_t i = 0; i < points.size(); i++) {
+    std::cout << std::endl
+              << "*** Sweep point " << i + 1 << "/" << points.size()
+              << ": burst " << points[i].burst << ", queueSize "
+              << points[i].queueSize << " ***" << std::endl;
+    RunSimulation(points[i].burst, points[i].queueSize, mtu, rate, peakRate,
+                  sim_name_full);
   }
   return 0;
 }
+
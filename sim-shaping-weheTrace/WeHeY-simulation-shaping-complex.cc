@@ -73,7 +73,7 @@ static void Ipv4RxTrace(Ptr<const Packet> packet, Ptr<Ipv4> ipv4,
     sumRxBytes += packet->GetSize();
 }
 
-std::ofstream droppedPacketsFile("wehe-dropped-packets.txt");
+static std::ofstream droppedPacketsFile;
 
 void PacketDropCallback(Ptr<const QueueDiscItem> item) {
   double dropSeconds = Simulator::Now().GetSeconds();
@@ -125,14 +125,16 @@ int main(int argc, char *argv[]) {
   NodeContainer nodes;
   nodes.Create(3);
 
+  DataRate linkRate = getLinkRate(DataRate("200Mb/s"));
+
   PointToPointHelper pointToPoint1;
   pointToPoint1.SetDeviceAttribute("DataRate",
-                                   StringValue("200Mb/s")); // link bandwidth
+                                   DataRateValue(linkRate)); // link bandwidth
   pointToPoint1.SetChannelAttribute("Delay", StringValue("5ms"));
 
   PointToPointHelper pointToPoint2;
   pointToPoint2.SetDeviceAttribute("DataRate",
-                                   StringValue("200Mb/s")); // link bandwidth
+                                   DataRateValue(linkRate)); // link bandwidth
   pointToPoint2.SetChannelAttribute("Delay", StringValue("5ms"));
 
   NetDeviceContainer devices1 =
@@ -214,12 +216,14 @@ int main(int argc, char *argv[]) {
   std::vector<std::string> args;
   args.push_back(std::to_string(burst));
   args.push_back(queueSize);
-  assignFiles(pointToPoint1, pointToPoint2, devices1, devices2, SIM_NAME, args);
+  assignFiles(pointToPoint1, pointToPoint2, devices1.Get(0), devices2.Get(1),
+              SIM_NAME, args);
+  droppedPacketsFile.open(getDroppedPacketsFileName(SIM_NAME, args));
 
   Ptr<PacketSink> sink = DynamicCast<PacketSink>(sinkApp.Get(0));
 
   Simulator::Stop(Seconds(simulationTime + 5));
-  Simulator::Run();
+  runAndPrintCost();
   Simulator::Destroy();
 
   double totalBytesReceived = g_ipRxTotal; // Get total received bytes
@@ -0,0 +1,489 @@
+/*
+ * Copyright (c) 2015 Universita' degli Studi di Napoli "Federico II"
+ *               2017 Kungliga Tekniska Högskolan
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Author: Pasquale Imputato <p.imputato@gmail.com>
+ * Author: Stefano Avallone <stefano.avallone@unina.it>
+ * Author: Surya Seetharaman <suryaseetharaman.9@gmail.com> - ported from ns-3
+ *         RedQueueDisc traffic-control example to accommodate TbfQueueDisc
+ * example.
+ */
+
+#include "complex-send-app.h"
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/tcp-header.h"
+#include "ns3/traffic-control-module.h"
+#include "queue-stats.h"
+#include "rate-estimator.h"
+#include "utils.h"
+
+#include <fstream> // store throughput data
+#include <iomanip>
+#include <string>
+#include <vector>
+
+// Distributed version of WeHeY-simulation-two-servers.cc, needs ns-3 built
+// with --enable-mpi and is run as
+//   ./ns3 run WeHeY-simulation-two-servers-mpi \
+//       --command-template="mpiexec -np N %s" -- [options]
+// so that ns3 builds once and only the simulation runs on N ranks
+//
+// Network topology
+//
+// b_0..b_k-1 -----|                   |----- r_0..r_k-1   (ranks 1..N-1)
+//                 |                   |
+//         n0 -----n3 (Queue X) ------ n6 ------n1 (TBF)----- n2   (rank 0)
+//    point-to-point links
+//
+// The measurement path stays on rank 0 together with the X queue and the
+// TBF (n6 -> n1 has no delay, so it cannot be cut). The background
+// senders b_i and receivers r_i are spread round robin over the other
+// ranks and joined to n3 and n6 by 5ms links, which is the lookahead. All
+// pcaps, traces, estimators and metadata are written by rank 0 only.
+//
+// The background traffic keeps the rate of the two-servers topology and
+// is split evenly over --backgroundFlows senders.
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("TbfExample");
+
+static uint32_t g_ipRxCount = 0;
+static uint32_t g_ipRxTotal = 0;
+
+static RateEstimators estimators;
+
+static const uint32_t MIN_SEND_RATE = 1;
+static const uint32_t MAX_SEND_RATE = 1448;
+
+static TraceSink cwndFile;
+static TraceSink rttFile;
+static TraceSink rtoFile;
+static TraceSink tokensFile;
+
+static const std::string SIM_NAME = "xtopo-mpi";
+
+static uint16_t testPort = 7;
+static uint16_t backgroundPort = 8;
+
+static QueueOccupancyStats xQueueStats;
+static QueueOccupancyStats tbfQueueStats;
+
+static void Ipv4RxTrace(Ptr<const Packet> packet, Ptr<Ipv4> ipv4,
+                        uint32_t interface) {
+  g_ipRxCount++;
+  g_ipRxTotal += packet->GetSize();
+  estimators.PacketDelivered(Simulator::Now().GetSeconds(), packet->GetSize());
+}
+
+static std::ofstream droppedPacketsFile;
+
+void PacketDropCallback(Ptr<const QueueDiscItem> item) {
+  double dropSeconds = Simulator::Now().GetSeconds();
+
+  estimators.PacketLost(dropSeconds);
+
+  TcpHeader tcpHeader;
+  Ptr<const Packet> packet = item->GetPacket();
+  if (packet->PeekHeader(tcpHeader))
+    droppedPacketsFile << dropSeconds << ","
+                       << tcpHeader.GetSequenceNumber().GetValue() << ","
+                       << packet->GetSize() << std::endl;
+  else
+    droppedPacketsFile << dropSeconds << ",," << packet->GetSize() << std::endl;
+}
+
+static void CwndTracer(uint32_t oldCwnd, uint32_t newCwnd) {
+  estimators.CwndChanged(Simulator::Now().GetSeconds(), newCwnd);
+  cwndFile.Write(Simulator::Now().GetSeconds(), newCwnd);
+}
+
+static void RttTracer(Time oldRtt, Time newRtt) {
+  estimators.RttChanged(Simulator::Now().GetSeconds(), newRtt.GetSeconds());
+  rttFile.Write(Simulator::Now().GetSeconds(), newRtt.GetSeconds());
+}
+
+static void RtoTracer(Time oldRto, Time newRto) {
+  estimators.RtoChanged(Simulator::Now().GetSeconds(), newRto.GetSeconds());
+  rtoFile.Write(Simulator::Now().GetSeconds(), newRto.GetSeconds());
+}
+
+void ConnectCwndTrace(Ptr<ComplexSendApplication> app) {
+  std::cout << "Connect TCP Traces" << std::endl;
+  Ptr<Socket> sock = app->GetSocket();
+  if (sock) {
+    sock->TraceConnectWithoutContext("CongestionWindow",
+                                     MakeCallback(&CwndTracer));
+    sock->TraceConnectWithoutContext("RTT", MakeCallback(&RttTracer));
+    sock->TraceConnectWithoutContext("RTO", MakeCallback(&RtoTracer));
+  } else
+    NS_LOG_ERROR("Socket still null at connect time");
+}
+
+static void RunSimulation(uint32_t burst, std::string queueSize, uint32_t mtu,
+                          DataRate rate, DataRate peakRate, double ratio,
+                          uint32_t reno, uint32_t backgroundFlows) {
+  double simulationTime = 11.1; // seconds
+  double simStart = 0.1;
+  double simEnd = simulationTime - 1;
+
+  uint32_t payloadSize = 1448; // bytes
+  double rtt = 0.03;
+
+  uint32_t systemId = MpiInterface::GetSystemId();
+  uint32_t systemCount = MpiInterface::GetSize();
+  bool measurementRank = systemId == 0;
+
+  DataRate measurementRate = getLinkRate(DataRate("200Mbps"));
+  DataRate backgroundRate = measurementRate * ratio;
+  DataRate intermediateRate = (measurementRate + backgroundRate) * 0.6;
+  DataRate flowRate = backgroundRate * (1.0 / backgroundFlows);
+
+  std::ostringstream ratio_oss;
+  ratio_oss << std::fixed << std::setprecision(2) << ratio;
+
+  std::string sim_name_full = SIM_NAME + "-" + ratio_oss.str();
+
+  if (reno) {
+    sim_name_full = "reno-" + sim_name_full;
+  }
+
+  // every rank creates every node, a node only runs on its own rank
+  NodeContainer nodes;
+  for (uint32_t i = 0; i < 4; i++)
+    nodes.Add(CreateObject<Node>(0));
+  Ptr<Node> n0 = nodes.Get(0);
+  Ptr<Node> n1 = nodes.Get(1);
+  Ptr<Node> n2 = nodes.Get(2);
+  Ptr<Node> n3 = nodes.Get(3);
+  Ptr<Node> n6 = CreateObject<Node>(0);
+  nodes.Add(n6);
+
+  NodeContainer senders, receivers;
+  for (uint32_t i = 0; i < backgroundFlows; i++) {
+    uint32_t rank = systemCount > 1 ? 1 + i % (systemCount - 1) : 0;
+    senders.Add(CreateObject<Node>(rank));
+    receivers.Add(CreateObject<Node>(rank));
+  }
+
+  PointToPointHelper pointToPoint_s_0;
+  pointToPoint_s_0.SetDeviceAttribute(
+      "DataRate",
+      DataRateValue(measurementRate)); // link bandwidth
+  pointToPoint_s_0.SetChannelAttribute("Delay", StringValue("5ms"));
+
+  PointToPointHelper pointToPoint_s_1;
+  pointToPoint_s_1.SetDeviceAttribute(
+      "DataRate",
+      DataRateValue(measurementRate)); // link bandwidth
+  pointToPoint_s_1.SetChannelAttribute("Delay", StringValue("5ms"));
+
+  PointToPointHelper pointToPoint_s_2;
+  pointToPoint_s_2.SetDeviceAttribute(
+      "DataRate",
+      DataRateValue(measurementRate)); // link bandwidth
+  pointToPoint_s_2.SetChannelAttribute(
+      "Delay", StringValue("0ms")); // no delay between X queue and TBF
+
+  PointToPointHelper pointToPoint_s_3;
+  pointToPoint_s_3.SetDeviceAttribute(
+      "DataRate",
+      DataRateValue(intermediateRate)); // link bandwidth
+  pointToPoint_s_3.SetChannelAttribute("Delay", StringValue("5ms"));
+
+  // crosses ranks, its delay is the lookahead
+  PointToPointHelper pointToPoint_b;
+  pointToPoint_b.SetDeviceAttribute("DataRate", DataRateValue(flowRate));
+  pointToPoint_b.SetChannelAttribute("Delay", StringValue("5ms"));
+
+  // Test server -> X queue
+  NetDeviceContainer devices_s_0 = pointToPoint_s_0.Install(n0, n3);
+  // TBF -> receiver
+  NetDeviceContainer devices_s_1 = pointToPoint_s_1.Install(n1, n2);
+  // X queue -> helper node
+  NetDeviceContainer devices_s_3 = pointToPoint_s_3.Install(n3, n6);
+  // helper node -> TBF
+  NetDeviceContainer devices_s_2 = pointToPoint_s_2.Install(n6, n1);
+
+  std::vector<NetDeviceContainer> devices_b_0, devices_b_1;
+  for (uint32_t i = 0; i < backgroundFlows; i++) {
+    // Background server -> X queue, helper node -> background receiver
+    devices_b_0.push_back(pointToPoint_b.Install(senders.Get(i), n3));
+    devices_b_1.push_back(pointToPoint_b.Install(n6, receivers.Get(i)));
+  }
+
+  InternetStackHelper stack;
+  stack.Install(nodes);
+  stack.Install(senders);
+  stack.Install(receivers);
+
+  // =========================== TBF QueueDisc ==========================
+  TrafficControlHelper tch;
+  tch.SetRootQueueDisc(getQueueDiscType(), "MaxSize",
+                       QueueSizeValue(QueueSize(queueSize)), "Burst",
+                       UintegerValue(burst), "Mtu", UintegerValue(mtu), "Rate",
+                       DataRateValue(DataRate(rate)), "PeakRate",
+                       DataRateValue(DataRate(peakRate)));
+  QueueDiscContainer qdiscs = tch.Install(devices_s_1.Get(0));
+  Ptr<QueueDisc> q = qdiscs.Get(0);
+
+  // =========================== X Queue ==========================
+  uint64_t bitRate = measurementRate.GetBitRate();
+
+  double bdpBits =
+      static_cast<uint32_t>(static_cast<double>(bitRate) * rtt / 8.0);
+
+  TrafficControlHelper tch_x;
+  tch_x.SetRootQueueDisc(
+      "ns3::FifoQueueDisc", "MaxSize",
+      QueueSizeValue(QueueSize(QueueSizeUnit::BYTES, bdpBits)));
+  QueueDiscContainer qdiscs_x = tch_x.Install(devices_s_3.Get(0));
+  Ptr<QueueDisc> q_x = qdiscs_x.Get(0);
+
+  //   10.1.1.x on n0 <-> n3 (Test server -> X queue)
+  //   10.1.2.x on n1 <-> n2 (TBF -> receiver)
+  //   10.1.3.x on n3 <-> n6 (X queue -> helper node)
+  //   10.1.6.x on n6 <-> n1 (helper node -> TBF)
+  //   10.2.x.x one /24 per background link
+  Ipv4AddressHelper address_s_0, address_s_1, address_s_2, address_s_3,
+      address_b;
+  address_s_0.SetBase("10.1.1.0", "255.255.255.0");
+  address_s_1.SetBase("10.1.2.0", "255.255.255.0");
+  address_s_2.SetBase("10.1.3.0", "255.255.255.0");
+  address_s_3.SetBase("10.1.6.0", "255.255.255.0");
+  address_b.SetBase("10.2.0.0", "255.255.255.0");
+
+  Ipv4InterfaceContainer ifaces_s_0 = address_s_0.Assign(devices_s_0);
+  Ipv4InterfaceContainer ifaces_s_1 = address_s_1.Assign(devices_s_1);
+  Ipv4InterfaceContainer ifaces_s_2 = address_s_2.Assign(devices_s_2);
+  Ipv4InterfaceContainer ifaces_s_3 = address_s_3.Assign(devices_s_3);
+
+  std::vector<Ipv4Address> receiverAddresses;
+  for (uint32_t i = 0; i < backgroundFlows; i++) {
+    address_b.Assign(devices_b_0[i]);
+    address_b.NewNetwork();
+    receiverAddresses.push_back(address_b.Assign(devices_b_1[i]).GetAddress(1));
+    address_b.NewNetwork();
+  }
+
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+
+  Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(payloadSize));
+
+  // background flows, on the rank that owns them
+  Address backgroundAddress(
+      InetSocketAddress(Ipv4Address::GetAny(), backgroundPort));
+  PacketSinkHelper backgroundSinkHelper("ns3::TcpSocketFactory",
+                                        backgroundAddress);
+  for (uint32_t i = 0; i < backgroundFlows; i++) {
+    if (senders.Get(i)->GetSystemId() != systemId)
+      continue;
+
+    ApplicationContainer sinkApp =
+        backgroundSinkHelper.Install(receivers.Get(i));
+    sinkApp.Start(Seconds(0.0));
+    sinkApp.Stop(Seconds(simulationTime));
+
+    // background is constant sized
+    BulkSendHelper bulkSend(
+        "ns3::TcpSocketFactory",
+        InetSocketAddress(receiverAddresses[i], backgroundPort));
+    bulkSend.SetAttribute("MaxBytes", UintegerValue(0));
+    bulkSend.SetAttribute("SendSize", UintegerValue(payloadSize));
+    ApplicationContainer apps = bulkSend.Install(senders.Get(i));
+    apps.Start(Seconds(simStart));
+    apps.Stop(Seconds(simEnd));
+  }
+
+  std::vector<std::string> args;
+  args.push_back(std::to_string(burst));
+  args.push_back(queueSize);
+
+  if (measurementRank) {
+    q->TraceConnectWithoutContext("Drop", MakeCallback(&PacketDropCallback));
+    tbfQueueStats.Attach(q, QueueSizeUnit::PACKETS);
+    xQueueStats.Attach(q_x, QueueSizeUnit::PACKETS);
+
+    // “Rx” will fire when IP receives a packet from the traffic-control layer
+    n2->GetObject<Ipv4>()->TraceConnectWithoutContext(
+        "Rx", MakeCallback(&Ipv4RxTrace));
+
+    Address localAddress1(InetSocketAddress(Ipv4Address::GetAny(), testPort));
+    PacketSinkHelper packetSinkHelper1("ns3::TcpSocketFactory",
+                                       localAddress1);
+    ApplicationContainer sinkApp1 = packetSinkHelper1.Install(n2);
+    sinkApp1.Start(Seconds(0.0));
+    sinkApp1.Stop(Seconds(simulationTime));
+
+    Ptr<ComplexSendApplication> app = CreateObject<ComplexSendApplication>();
+    app->SetAttribute("Remote", AddressValue(InetSocketAddress(
+                                    ifaces_s_1.GetAddress(1), testPort)));
+    app->SetAttribute("MaxBytes",
+                      UintegerValue(0)); // 0 means send indefinitely
+    app->SetAttribute("MinSend", UintegerValue(MIN_SEND_RATE));
+    app->SetAttribute("MaxSend", UintegerValue(MAX_SEND_RATE));
+    n0->AddApplication(app);
+    app->SetStartTime(Seconds(simStart));
+    app->SetStopTime(Seconds(simEnd));
+
+    Simulator::Schedule(
+        Seconds(simStart + 1e-7), // a bit after StartApplication()
+        MakeBoundCallback(&ConnectCwndTrace, app));
+
+    assignFiles(pointToPoint_s_0, pointToPoint_s_1, devices_s_0.Get(0),
+                devices_s_1.Get(1), sim_name_full, args);
+    getTracerFiles(sim_name_full, args, cwndFile, rttFile, rtoFile);
+    getTokensFile(q, sim_name_full, args, tokensFile);
+    droppedPacketsFile.open(getDroppedPacketsFileName(sim_name_full, args));
+  }
+
+  // early stops are local to a rank, only the fixed stop time is global
+  Simulator::Stop(Seconds(simulationTime + 5));
+  runAndPrintCost();
+
+  if (measurementRank) {
+    xQueueStats.Finish(Simulator::Now().GetSeconds());
+    tbfQueueStats.Finish(Simulator::Now().GetSeconds());
+  }
+
+  Simulator::Destroy();
+
+  if (!measurementRank)
+    return;
+
+  double totalBytesReceived = g_ipRxTotal; // Get total received bytes
+  double throughput =
+      (totalBytesReceived * 8) / simulationTime; // Convert to bits per second
+
+  std::cout << std::endl << "*** Throughput Statistics ***" << std::endl;
+  std::cout << "Ranks: " << systemCount
+            << ", background flows: " << backgroundFlows << std::endl;
+  std::cout << "Total Bytes Received: " << totalBytesReceived << " bytes"
+            << std::endl;
+  std::cout << "Throughput: " << throughput / 1e6 << " Mbps" << std::endl;
+
+  std::cout << "\n*** In-Queue Statistics ***" << std::endl;
+  xQueueStats.Print(std::cout);
+
+  std::cout << "\n*** TBF Queue Statistics ***" << std::endl;
+  tbfQueueStats.Print(std::cout);
+
+  cwndFile.Close();
+  rttFile.Close();
+  rtoFile.Close();
+  tokensFile.Close();
+  droppedPacketsFile.close();
+  closeEventLogs();
+
+  const GoogleRateEstimator &google = estimators.GetGoogle();
+  std::ofstream metadata(getMetadataFileName(sim_name_full, args));
+  metadata << throughput << std::endl;  // Log throughput in bps
+  metadata << google.GetLossCount()
+           << std::endl; // Log number of dropped packets
+  estimators.WriteMetadata(metadata);
+  xQueueStats.WriteMetadata(metadata, "x_queue");
+  tbfQueueStats.WriteMetadata(metadata, "tbf_queue");
+  metadata << "mpi_ranks=" << systemCount << std::endl;
+  metadata << "background_flows=" << backgroundFlows << std::endl;
+  metadata.close();
+
+  ResultRecord result = getResultRecord(SIM_NAME, sim_name_full, args);
+  result.SetParameter("burst", burst);
+  result.SetParameter("queueSize", queueSize);
+  result.SetParameter("mtu", mtu);
+  result.SetParameter("rate", rate.GetBitRate());
+  result.SetParameter("peakRate", peakRate.GetBitRate());
+  result.SetParameter("trafficRatio", ratio);
+  result.SetParameter("reno", reno);
+  result.SetParameter("backgroundFlows", backgroundFlows);
+  result.ReadMetadata(getMetadataFileName(sim_name_full, args));
+  appendResult(result);
+
+  std::cout << std::endl << "*** TC Layer statistics ***" << std::endl;
+  std::cout << q->GetStats() << std::endl;
+
+  std::cout << "IP-layer Rx Count (after queue disc):  " << g_ipRxCount
+            << std::endl;
+
+  if (google.GetLossCount() > 0) {
+    std::cout << std::endl << "*** Google paper estimation ***" << std::endl;
+    std::cout << "The number of losses: " << google.GetLossCount()
+              << std::endl;
+    std::cout << "Estimated goodput: " << google.GetRate() / 8 << " B/s\t -> "
+              << google.GetRate() << " b/s" << std::endl;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t burst = 500000;
+  uint32_t mtu = 0; // second bucket is disabled
+  DataRate rate = DataRate("2Mbps");
+  DataRate peakRate = DataRate("0bps");
+
+  Config::SetDefault("ns3::TcpSocket::SndBufSize", UintegerValue(1500000));
+  Config::SetDefault("ns3::TcpSocket::RcvBufSize", UintegerValue(1500000));
+
+  Config::SetDefault("ns3::TcpL4Protocol::SocketType",
+                     TypeIdValue(TcpNewReno::GetTypeId()));
+
+  double ratio = 1.0; // ratio of measurement traffic to background traffic
+
+  std::string queueSize = "1p";
+
+  uint32_t reno = 0;
+
+  uint32_t backgroundFlows = 1;
+
+  // before MpiInterface::Enable, the simulator is created there
+  GlobalValue::Bind("SimulatorImplementationType",
+                    StringValue("ns3::DistributedSimulatorImpl"));
+  MpiInterface::Enable(&argc, &argv);
+
+  CommandLine cmd(__FILE__);
+  cmd.AddValue("burst", "Size of first bucket in bytes", burst);
+  cmd.AddValue("mtu", "Size of second bucket in bytes", mtu);
+  cmd.AddValue("rate", "Rate of tokens arriving in first bucket", rate);
+  cmd.AddValue("peakRate", "Rate of tokens arriving in second bucket",
+               peakRate);
+  cmd.AddValue("queueSize",
+               "Amount of bytes or packets that can be stored in the bucket "
+               "instead of dropping the packet. Queue size in bytes or packets",
+               queueSize);
+  cmd.AddValue("trafficRatio",
+               "Multiplier to compute the background traffic rate "
+               "from the measurement traffic rate. ",
+               ratio);
+  cmd.AddValue("reno",
+               "Set to use TCP Reno instead of Cubic (default is Cubic)", reno);
+  cmd.AddValue("backgroundFlows",
+               "Number of background senders sharing the background rate, "
+               "spread over the ranks other than 0",
+               backgroundFlows);
+
+  cmd.Parse(argc, argv);
+
+  if (backgroundFlows == 0)
+    NS_FATAL_ERROR("At least one background flow is needed");
+
+  if (reno) {
+    Config::SetDefault("ns3::TcpL4Protocol::SocketType",
+                       TypeIdValue(TcpNewReno::GetTypeId()));
+    std::cout << "Using TCP Reno" << std::endl;
+  }
+
+  // recorded, but never skipped: all ranks would have to agree on it
+  setBaseConfigHash(argc, argv, {});
+
+  RunSimulation(burst, queueSize, mtu, rate, peakRate, ratio, reno,
+                backgroundFlows);
+
+  MpiInterface::Disable();
+  return 0;
+}
@@ -21,11 +21,18 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/tcp-header.h"
 #include "ns3/traffic-control-module.h"
+#include "drain-detector.h"
+#include "queue-stats.h"
+#include "rate-estimator.h"
 #include "utils.h"
 
+#include <algorithm>
 #include <fstream> // store throughput data
 #include <iomanip>
+#include <map>
 #include <string>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <vector>
 
 // This simple example shows how to use TrafficControlHelper to install a
@@ -55,24 +62,25 @@ static uint32_t g_ipTxCount = 0;
 static uint32_t g_ipRxCount = 0;
 static uint32_t g_ipRxTotal = 0;
 
-static uint32_t sumRxBytes = 0;
-static double t_firstLoss = -1.0;
-static double t_lastLoss = -1.0;
+static RateEstimators estimators;
+static ConvergenceMonitor convergence;
+static DrainDetector drainDetector;
 
 static const uint32_t MIN_SEND_RATE = 1;
 static const uint32_t MAX_SEND_RATE = 1448;
 
-static std::ofstream cwndFile;
-static std::ofstream rttFile;
-static std::ofstream rtoFile;
+static TraceSink cwndFile;
+static TraceSink rttFile;
+static TraceSink rtoFile;
+static TraceSink tokensFile;
 
 static const std::string SIM_NAME = "xtopo";
 
 static uint16_t testPort = 7;
 static uint16_t backgroundPort = 8;
 
-static std::vector<uint32_t> sums;
-static std::vector<uint32_t> inQueue;
+static QueueOccupancyStats xQueueStats;
+static QueueOccupancyStats tbfQueueStats;
 
 static void Ipv4RxTrace(Ptr<const Packet> packet, Ptr<Ipv4> ipv4,
                         uint32_t interface) {
@@ -80,19 +88,19 @@ static void Ipv4RxTrace(Ptr<const Packet> packet, Ptr<Ipv4> ipv4,
   // std::cout << "received: " << packet->GetSize() << std::endl;
   g_ipRxCount++;
   g_ipRxTotal += packet->GetSize();
-  if (t_firstLoss > 0)
-    sumRxBytes += packet->GetSize();
+  estimators.PacketDelivered(Simulator::Now().GetSeconds(), packet->GetSize());
+  if (convergence.PacketDelivered(Simulator::Now().GetSeconds()))
+    Simulator::Stop();
 }
 
-std::ofstream droppedPacketsFile("wehe-dropped-packets.txt");
+static std::ofstream droppedPacketsFile;
 
 void PacketDropCallback(Ptr<const QueueDiscItem> item) {
   double dropSeconds = Simulator::Now().GetSeconds();
 
-  if (t_firstLoss < 0)
-    t_firstLoss = dropSeconds;
-  t_lastLoss = dropSeconds;
-  sums.push_back(sumRxBytes);
+  estimators.PacketLost(dropSeconds);
+  if (convergence.PacketLost(dropSeconds, estimators.GetGoogle().GetRate()))
+    Simulator::Stop();
 
   TcpHeader tcpHeader;
   Ptr<const Packet> packet = item->GetPacket();
@@ -104,22 +112,19 @@ void PacketDropCallback(Ptr<const QueueDiscItem> item) {
     droppedPacketsFile << dropSeconds << ",," << packet->GetSize() << std::endl;
 }
 
-void PacketsInQueueCallback(uint32_t oldValue, uint32_t newValue) {
-  inQueue.push_back(newValue);
-}
-
 static void CwndTracer(uint32_t oldCwnd, uint32_t newCwnd) {
-  cwndFile << Simulator::Now().GetSeconds() << "," << newCwnd << std::endl;
+  estimators.CwndChanged(Simulator::Now().GetSeconds(), newCwnd);
+  cwndFile.Write(Simulator::Now().GetSeconds(), newCwnd);
 }
 
 static void RttTracer(Time oldRtt, Time newRtt) {
-  rttFile << Simulator::Now().GetSeconds() << "," << newRtt.GetSeconds()
-          << std::endl;
+  estimators.RttChanged(Simulator::Now().GetSeconds(), newRtt.GetSeconds());
+  rttFile.Write(Simulator::Now().GetSeconds(), newRtt.GetSeconds());
 }
 
 static void RtoTracer(Time oldRto, Time newRto) {
-  rtoFile << Simulator::Now().GetSeconds() << "," << newRto.GetSeconds()
-          << std::endl;
+  estimators.RtoChanged(Simulator::Now().GetSeconds(), newRto.GetSeconds());
+  rtoFile.Write(Simulator::Now().GetSeconds(), newRto.GetSeconds());
 }
 
 void ConnectCwndTrace(Ptr<ComplexSendApplication> app) {
@@ -134,68 +139,90 @@ void ConnectCwndTrace(Ptr<ComplexSendApplication> app) {
     NS_LOG_ERROR("Socket still null at connect time");
 }
 
-int main(int argc, char *argv[]) {
-  //   LogComponentEnable("TbfExample", LOG_LEVEL_INFO);
-  //   LogComponentEnable("ComplexSendApplication", LOG_LEVEL_DEBUG);
-
-  double simulationTime = 11.1; // seconds
-  double simStart = 0.1;
-  double simEnd = simulationTime - 1;
-
-  uint32_t payloadSize = 1448; // bytes
-  uint32_t burst = 500000;
-  uint32_t mtu = 0; // second bucket is disabled
-  DataRate rate = DataRate("2Mbps");
-  DataRate peakRate = DataRate("0bps");
-  double rtt = 0.03;
+// Clears the per-run counters and trace files so that the next point of an
+// in-process sweep starts from the same state as a fresh process.
+static void ResetRunState() {
+  g_ipTxCount = 0;
+  g_ipRxCount = 0;
+  g_ipRxTotal = 0;
+  estimators.Reset();
+  convergence.Reset();
+  drainDetector.Reset();
+  xQueueStats.Reset();
+  tbfQueueStats.Reset();
+
+  cwndFile.Close();
+  rttFile.Close();
+  rtoFile.Close();
+  tokensFile.Close();
+  droppedPacketsFile.close();
+  closeEventLogs();
 
-  Config::SetDefault("ns3::TcpSocket::SndBufSize", UintegerValue(1500000));
-  Config::SetDefault("ns3::TcpSocket::RcvBufSize", UintegerValue(1500000));
+  // Addresses and random streams are process-wide, not owned by the simulator
+  Ipv4AddressGenerator::Reset();
+  RngSeedManager::ResetNextStreamIndex();
+}
 
-  Config::SetDefault("ns3::TcpL4Protocol::SocketType",
-                     TypeIdValue(TcpNewReno::GetTypeId()));
+// What the second half of a run needs from the topology. Built once per
+// point, or once per trafficRatio in the fork-server mode.
+struct Scenario {
+  std::string simName;
+  uint32_t mtu;
+  DataRate rate;
+  DataRate peakRate;
+  double trafficRatio;
+  uint32_t reno;
+  double simulationTime;
+  PointToPointHelper serverLink;
+  PointToPointHelper clientLink;
+  Ptr<NetDevice> serverDevice;
+  Ptr<NetDevice> clientDevice;
+  Ptr<QueueDisc> tbf;
+};
+
+static std::string GetSimName(double ratio, uint32_t reno) {
+  std::ostringstream ratio_oss;
+  ratio_oss << std::fixed << std::setprecision(2) << ratio;
 
-  double ratio = 1.0; // ratio of measurement traffic to background traffic
+  std::string sim_name_full = SIM_NAME + "-" + ratio_oss.str();
 
-  std::string queueSize = "1p";
+  if (reno) {
+    sim_name_full = "reno-" + sim_name_full;
+  }
+  return sim_name_full;
+}
 
-  uint32_t reno = 0;
+// Whether the result store already has this point, see isCompleted
+static bool IsPointCompleted(uint32_t burst, std::string queueSize,
+                             double ratio, uint32_t reno) {
+  std::vector<std::string> args;
+  args.push_back(std::to_string(burst));
+  args.push_back(queueSize);
+  if (!isCompleted(getConfigHash(GetSimName(ratio, reno), args)))
+    return false;
+  std::cout << "Skipping burst " << burst << ", queueSize " << queueSize
+            << ", trafficRatio " << ratio << ": already in the result store"
+            << std::endl;
+  return true;
+}
 
-  CommandLine cmd(__FILE__);
-  cmd.AddValue("burst", "Size of first bucket in bytes", burst);
-  cmd.AddValue("mtu", "Size of second bucket in bytes", mtu);
-  cmd.AddValue("rate", "Rate of tokens arriving in first bucket", rate);
-  cmd.AddValue("peakRate", "Rate of tokens arriving in second bucket",
-               peakRate);
-  cmd.AddValue("queueSize",
-               "Amount of bytes or packets that can be stored in the bucket "
-               "instead of dropping the packet. Queue size in bytes or packets",
-               queueSize);
+static Scenario BuildScenario(uint32_t burst, std::string queueSize,
+                              uint32_t mtu, DataRate rate, DataRate peakRate,
+                              double ratio, uint32_t reno) {
+  configureConvergence(convergence);
 
-  cmd.AddValue("trafficRatio",
-               "Multiplier to compute the background traffic rate "
-               "from the measurement traffic rate. ",
-               ratio);
-  cmd.AddValue("reno",
-               "Set to use TCP Reno instead of Cubic (default is Cubic)", reno);
+  double simulationTime = 11.1; // seconds
+  double simStart = 0.1;
+  double simEnd = simulationTime - 1;
 
-  cmd.Parse(argc, argv);
+  uint32_t payloadSize = 1448; // bytes
+  double rtt = 0.03;
 
-  DataRate measurementRate = DataRate("200Mbps");
+  DataRate measurementRate = getLinkRate(DataRate("200Mbps"));
   DataRate backgroundRate = measurementRate * ratio;
   DataRate intermediateRate = (measurementRate + backgroundRate) * 0.6;
 
-  std::ostringstream ratio_oss;
-  ratio_oss << std::fixed << std::setprecision(2) << ratio;
-
-  std::string sim_name_full = SIM_NAME + "-" + ratio_oss.str();
-
-  if (reno) {
-     Config::SetDefault("ns3::TcpL4Protocol::SocketType",
-                     TypeIdValue(TcpNewReno::GetTypeId()));
-    std::cout << "Using TCP Reno" << std::endl;
-    sim_name_full = "reno-" + sim_name_full;
-  }
+  std::string sim_name_full = GetSimName(ratio, reno);
 
   NodeContainer nodes;
   nodes.Create(7);
@@ -267,7 +294,7 @@ int main(int argc, char *argv[]) {
 
   // =========================== TBF QueueDisc ==========================
   TrafficControlHelper tch;
-  tch.SetRootQueueDisc("ns3::TbfQueueDisc", "MaxSize",
+  tch.SetRootQueueDisc(getQueueDiscType(), "MaxSize",
                        QueueSizeValue(QueueSize(queueSize)), "Burst",
                        UintegerValue(burst), "Mtu", UintegerValue(mtu), "Rate",
                        DataRateValue(DataRate(rate)), "PeakRate",
@@ -275,6 +302,7 @@ int main(int argc, char *argv[]) {
   QueueDiscContainer qdiscs = tch.Install(devices_s_1.Get(0));
   Ptr<QueueDisc> q = qdiscs.Get(0);
   q->TraceConnectWithoutContext("Drop", MakeCallback(&PacketDropCallback));
+  tbfQueueStats.Attach(q, QueueSizeUnit::PACKETS);
 
   // =========================== X Queue ==========================
   uint64_t bitRate = measurementRate.GetBitRate();
@@ -288,8 +316,7 @@ int main(int argc, char *argv[]) {
       QueueSizeValue(QueueSize(QueueSizeUnit::BYTES, bdpBits)));
   QueueDiscContainer qdiscs_x = tch_x.Install(devices_s_3.Get(0));
   Ptr<QueueDisc> q_x = qdiscs_x.Get(0);
-  q_x->TraceConnectWithoutContext("PacketsInQueue",
-                                  MakeCallback(&PacketsInQueueCallback));
+  xQueueStats.Attach(q_x, QueueSizeUnit::PACKETS);
   // Assign IP addresses:
 
   //   10.1.1.x on n0 <-> n3 (Test server -> X queue)
@@ -368,49 +395,103 @@ int main(int argc, char *argv[]) {
   apps2.Start(Seconds(simStart));
   apps2.Stop(Seconds(simEnd));
 
-  cwndFile << "time,cwnd" << std::endl;
   Simulator::Schedule(
       Seconds(simStart + 1e-7), // a bit after StartApplication()
       MakeBoundCallback(&ConnectCwndTrace, app));
 
+  Scenario scenario;
+  scenario.simName = sim_name_full;
+  scenario.mtu = mtu;
+  scenario.rate = rate;
+  scenario.peakRate = peakRate;
+  scenario.trafficRatio = ratio;
+  scenario.reno = reno;
+  scenario.simulationTime = simulationTime;
+  scenario.serverLink = pointToPoint_s_0;
+  scenario.clientLink = pointToPoint_s_1;
+  scenario.serverDevice = devices_s_0.Get(0);
+  scenario.clientDevice = devices_s_1.Get(1);
+  scenario.tbf = q;
+  return scenario;
+}
+
+// Opens the per-point output files, runs the simulation from wherever it
+// is to the end and writes the results.
+static void FinishSimulation(Scenario &scenario, uint32_t burst,
+                             std::string queueSize) {
+  std::string sim_name_full = scenario.simName;
+  double simulationTime = scenario.simulationTime;
+  Ptr<QueueDisc> q = scenario.tbf;
+
   std::vector<std::string> args;
   args.push_back(std::to_string(burst));
   args.push_back(queueSize);
-  assignFiles(pointToPoint_s_0, pointToPoint_s_1, devices_s_0.Get(0),
-              devices_s_1.Get(1), sim_name_full, args);
+  assignFiles(scenario.serverLink, scenario.clientLink, scenario.serverDevice,
+              scenario.clientDevice, sim_name_full, args);
 
   getTracerFiles(sim_name_full, args, cwndFile, rttFile, rtoFile);
+  getTokensFile(q, sim_name_full, args, tokensFile);
+  droppedPacketsFile.open(getDroppedPacketsFileName(sim_name_full, args));
+
+  Simulator::Stop(Seconds(simulationTime + 5) - Simulator::Now());
+  if (getDrainDetection())
+    drainDetector.Schedule(Seconds(simulationTime + 5));
+  runAndPrintCost();
 
-  Simulator::Stop(Seconds(simulationTime + 5));
-  Simulator::Run();
+  xQueueStats.Finish(Simulator::Now().GetSeconds());
+  tbfQueueStats.Finish(Simulator::Now().GetSeconds());
 
   Simulator::Destroy();
 
   double totalBytesReceived = g_ipRxTotal; // Get total received bytes
+  // a run stopped early only delivered up to its stop time
+  double runTime =
+      convergence.IsStopped() ? convergence.GetStopTime() : simulationTime;
   double throughput =
-      (totalBytesReceived * 8) / simulationTime; // Convert to bits per second
+      (totalBytesReceived * 8) / runTime; // Convert to bits per second
 
   std::cout << std::endl << "*** Throughput Statistics ***" << std::endl;
   std::cout << "Total Bytes Received: " << totalBytesReceived << " bytes"
             << std::endl;
   std::cout << "Throughput: " << throughput / 1e6 << " Mbps" << std::endl;
-
-  uint32_t allpackets = 0;
-  for (const auto &num : inQueue) {
-    allpackets += num;
-  }
+  if (drainDetector.IsDrained())
+    std::cout << "Drained at " << drainDetector.GetDrainTime() << " s, "
+              << drainDetector.GetSavedTime() << " s not simulated"
+              << std::endl;
 
   std::cout << "\n*** In-Queue Statistics ***" << std::endl;
-  std::cout << "In-Queue Average Packet Count: "
-            << allpackets / static_cast<double>(inQueue.size()) << std::endl;
+  std::cout << "In-Queue Average Packet Count: " << xQueueStats.GetEventMean()
+            << std::endl;
+  xQueueStats.Print(std::cout);
+
+  std::cout << "\n*** TBF Queue Statistics ***" << std::endl;
+  tbfQueueStats.Print(std::cout);
 
   droppedPacketsFile.close();
 
+  const GoogleRateEstimator &google = estimators.GetGoogle();
   std::ofstream metadata(getMetadataFileName(sim_name_full, args));
   metadata << throughput << std::endl;  // Log throughput in bps
-  metadata << sums.size() << std::endl; // Log number of dropped packets
+  metadata << google.GetLossCount()
+           << std::endl; // Log number of dropped packets
+  estimators.WriteMetadata(metadata);
+  convergence.WriteMetadata(metadata);
+  drainDetector.WriteMetadata(metadata);
+  xQueueStats.WriteMetadata(metadata, "x_queue");
+  tbfQueueStats.WriteMetadata(metadata, "tbf_queue");
   metadata.close();
 
+  ResultRecord result = getResultRecord(SIM_NAME, sim_name_full, args);
+  result.SetParameter("burst", burst);
+  result.SetParameter("queueSize", queueSize);
+  result.SetParameter("mtu", scenario.mtu);
+  result.SetParameter("rate", scenario.rate.GetBitRate());
+  result.SetParameter("peakRate", scenario.peakRate.GetBitRate());
+  result.SetParameter("trafficRatio", scenario.trafficRatio);
+  result.SetParameter("reno", scenario.reno);
+  result.ReadMetadata(getMetadataFileName(sim_name_full, args));
+  appendResult(result);
+
   std::cout << std::endl << "*** TC Layer statistics ***" << std::endl;
   std::cout << q->GetStats() << std::endl;
 
@@ -419,18 +500,186 @@ int main(int argc, char *argv[]) {
   std::cout << "IP-layer Rx Count (after queue disc):  " << g_ipRxCount
             << std::endl;
 
-  if (!sums.empty()) {
+  if (google.GetLossCount() > 0) {
     std::cout << std::endl << "*** Google paper estimation ***" << std::endl;
     std::cout << "Time between first and last loss: "
-              << t_lastLoss - t_firstLoss << std::endl;
-    std::cout << "The number of sums: " << sums.size() << std::endl;
+              << google.GetLastLossTime() - google.GetFirstLossTime()
+              << std::endl;
+    std::cout << "The number of losses: " << google.GetLossCount()
+              << std::endl;
     std::cout << "Bytes received in between first and last loss: "
-              << sums[sums.size() - 1] << std::endl;
-    std::cout << "Estimated goodput: "
-              << sums[sums.size() - 1] / (t_lastLoss - t_firstLoss)
-              << " B/s\t -> "
-              << sums[sums.size() - 1] / (t_lastLoss - t_firstLoss) * 8
-              << " b/s" << std::endl;
+              << google.GetDeliveredBytes() << std::endl;
+    std::cout << "Estimated goodput: " << google.GetRate() / 8 << " B/s\t -> "
+              << google.GetRate() << " b/s" << std::endl;
+  }
+
+  ResetRunState();
+}
+
+static void RunSimulation(uint32_t burst, std::string queueSize, uint32_t mtu,
+                          DataRate rate, DataRate peakRate, double ratio,
+                          uint32_t reno) {
+  if (IsPointCompleted(burst, queueSize, ratio, reno))
+    return;
+  Scenario scenario =
+      BuildScenario(burst, queueSize, mtu, rate, peakRate, ratio, reno);
+  FinishSimulation(scenario, burst, queueSize);
+}
+
+static void WaitForPoint() {
+  int status = 0;
+  pid_t pid = wait(&status);
+  if (pid > 0 && !(WIFEXITED(status) && WEXITSTATUS(status) == 0))
+    std::cerr << "Sweep point in process " << pid << " failed" << std::endl;
+}
+
+// Fork-server mode: the points of one trafficRatio share the topology, so it
+// is built once and every point is forked from there, setting only its own
+// Burst and MaxSize. Only the construction is shared, no simulated time:
+// any state after the first packet would make the points differ from runs
+// of their own. The children start with an empty queue and a full bucket
+// like an independent run: the bucket is built with the largest burst of
+// the group, and the queue discs clamp it to the child's Burst on the next
+// refill.
+static void RunForkServer(const std::vector<SweepPoint> &points, uint32_t mtu,
+                          DataRate rate, DataRate peakRate, uint32_t reno,
+                          uint32_t jobs) {
+  std::map<double, std::vector<SweepPoint>> groups;
+  for (const SweepPoint &point : points) {
+    if (!IsPointCompleted(point.burst, point.queueSize, point.trafficRatio,
+                          reno))
+      groups[point.trafficRatio].push_back(point);
+  }
+
+  for (auto &group : groups) {
+    uint32_t maxBurst = 0;
+    for (const SweepPoint &point : group.second)
+      maxBurst = std::max(maxBurst, point.burst);
+
+    Scenario scenario = BuildScenario(maxBurst, group.second[0].queueSize, mtu,
+                                      rate, peakRate, group.first, reno);
+    // or the children print it again
+    std::cout.flush();
+
+    uint32_t running = 0;
+    for (const SweepPoint &point : group.second) {
+      if (running >= jobs) {
+        WaitForPoint();
+        running--;
+      }
+
+      pid_t pid = fork();
+      if (pid < 0)
+        NS_FATAL_ERROR("Could not fork a sweep point");
+      if (pid == 0) {
+        std::cout << std::endl
+                  << "*** Sweep point: burst " << point.burst
+                  << ", queueSize " << point.queueSize << ", trafficRatio "
+                  << point.trafficRatio << " ***" << std::endl;
+        scenario.tbf->SetAttribute("Burst", UintegerValue(point.burst));
+        scenario.tbf->SetMaxSize(QueueSize(point.queueSize));
+        FinishSimulation(scenario, point.burst, point.queueSize);
+        std::cout.flush();
+        _exit(0);
+      }
+      running++;
+    }
+    while (running > 0) {
+      WaitForPoint();
+      running--;
+    }
+
+    Simulator::Destroy();
+    ResetRunState();
+  }
+}
+
+int main(int argc, char *argv[]) {
+  //   LogComponentEnable("TbfExample", LOG_LEVEL_INFO);
+  //   LogComponentEnable("ComplexSendApplication", LOG_LEVEL_DEBUG);
+
+  uint32_t burst = 500000;
+  uint32_t mtu = 0; // second bucket is disabled
+  DataRate rate = DataRate("2Mbps");
+  DataRate peakRate = DataRate("0bps");
+
+  Config::SetDefault("ns3::TcpSocket::SndBufSize", UintegerValue(1500000));
+  Config::SetDefault("ns3::TcpSocket::RcvBufSize", UintegerValue(1500000));
+
+  Config::SetDefault("ns3::TcpL4Protocol::SocketType",
+                     TypeIdValue(TcpNewReno::GetTypeId()));
+
+  double ratio = 1.0; // ratio of measurement traffic to background traffic
+
+  std::string queueSize = "1p";
+
+  uint32_t reno = 0;
+
+  std::string sweepFile = "";
+  bool forkServer = false;
+  uint32_t forkJobs = 1;
+
+  CommandLine cmd(__FILE__);
+  cmd.AddValue("burst", "Size of first bucket in bytes", burst);
+  cmd.AddValue("mtu", "Size of second bucket in bytes", mtu);
+  cmd.AddValue("rate", "Rate of tokens arriving in first bucket", rate);
+  cmd.AddValue("peakRate", "Rate of tokens arriving in second bucket",
+               peakRate);
+  cmd.AddValue("queueSize",
+               "Amount of bytes or packets that can be stored in the bucket "
+               "instead of dropping the packet. Queue size in bytes or packets",
+               queueSize);
+
+  cmd.AddValue("trafficRatio",
+               "Multiplier to compute the background traffic rate "
+               "from the measurement traffic rate. ",
+               ratio);
+  cmd.AddValue("reno",
+               "Set to use TCP Reno instead of Cubic (default is Cubic)", reno);
+  cmd.AddValue("sweep",
+               "File with one burst,queueSize,trafficRatio point per line. All "
+               "points are run in this process instead of burst, queueSize "
+               "and trafficRatio",
+               sweepFile);
+  cmd.AddValue("fork",
+               "Build the topology once per trafficRatio of the sweep and "
+               "fork a process for each of its points",
+               forkServer);
+  cmd.AddValue("forkJobs", "Number of forked points running at once",
+               forkJobs);
+
+  cmd.Parse(argc, argv);
+
+  if (reno) {
+     Config::SetDefault("ns3::TcpL4Protocol::SocketType",
+                     TypeIdValue(TcpNewReno::GetTypeId()));
+    std::cout << "Using TCP Reno" << std::endl;
+  }
+
+  // fork runs give the same results, so they match completed runs without
+  setBaseConfigHash(argc, argv,
+                    {"burst", "queueSize", "trafficRatio", "sweep", "fork",
+                     "forkJobs"});
+
+  if (sweepFile.empty()) {
+    RunSimulation(burst, queueSize, mtu, rate, peakRate, ratio, reno);
+    return 0;
+  }
+
+  std::vector<SweepPoint> points = readSweepPoints(sweepFile);
+  if (forkServer) {
+    RunForkServer(points, mtu, rate, peakRate, reno,
+                  std::max<uint32_t>(forkJobs, 1));
+    return 0;
+  }
+  for (size_t i = 0; i < points.size(); i++) {
+    std::cout << std::endl
+              << "*** Sweep point " << i + 1 << "/" << points.size()
+              << ": burst " << points[i].burst << ", queueSize "
+              << points[i].queueSize << ", trafficRatio "
+              << points[i].trafficRatio << " ***" << std::endl;
+    RunSimulation(points[i].burst, points[i].queueSize, mtu, rate, peakRate,
+                  points[i].trafficRatio, reno);
   }
   return 0;
 }
@@ -0,0 +1,432 @@
+/*
+ * Standalone loss matcher for a server-side and a client-side pcap, the
+ * C++ counterpart of utils.get_lossEvents_from_server_client_pcaps.
+ *
+ * Both captures are mapped into memory and the Ethernet/PPP/SLL + IPv4 + TCP
+ * headers are decoded in place. The server's data segments are put in an
+ * open-addressing hash table keyed on the flow and sequence number, the
+ * client's segments are looked up in it, and a segment is lost when it never
+ * reached the client. Of several transmissions of one segment, the ones sent
+ * before it arrived are lost except for the latest, as in the Python version.
+ *
+ * It lives outside the simulation directory so ns-3 does not build it:
+ *
+ *   g++ -O2 -std=c++17 -o pcap-loss-matcher pcap-loss-matcher.cc
+ *   ./pcap-loss-matcher --server-port 49153 server.pcap client.pcap out.csv
+ *
+ * The output has one row per server data segment: timestamp,pkt_len,seq,
+ * is_lost (CSV), or with --binary an array of LossRecord.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const uint32_t PCAP_MAGIC_US = 0xa1b2c3d4;
+static const uint32_t PCAP_MAGIC_NS = 0xa1b23c4d;
+
+static const uint32_t LINKTYPE_ETHERNET = 1;
+static const uint32_t LINKTYPE_PPP = 9;
+static const uint32_t LINKTYPE_RAW = 101;
+static const uint32_t LINKTYPE_IPV4 = 228;
+static const uint32_t LINKTYPE_LINUX_SLL = 113;
+static const uint32_t LINKTYPE_LINUX_SLL2 = 276;
+
+static const uint16_t ETHERTYPE_IPV4 = 0x0800;
+static const uint16_t ETHERTYPE_VLAN = 0x8100;
+static const uint16_t PPP_IPV4 = 0x0021;
+static const uint8_t IP_PROTOCOL_TCP = 6;
+
+// One output row of --binary
+struct LossRecord {
+  double timestamp; // relative to the first packet of the server pcap
+  uint32_t pktLen;  // ip.len
+  uint32_t seq;     // raw tcp.seq
+  uint8_t isLost;
+  uint8_t reserved[7];
+};
+
+static_assert(sizeof(LossRecord) == 24, "loss records must stay 24 bytes");
+
+struct FlowKey {
+  uint32_t srcIp;
+  uint32_t dstIp;
+  uint16_t srcPort;
+  uint16_t dstPort;
+  uint32_t seq;
+
+  bool operator==(const FlowKey &other) const {
+    return srcIp == other.srcIp && dstIp == other.dstIp &&
+           srcPort == other.srcPort && dstPort == other.dstPort &&
+           seq == other.seq;
+  }
+};
+
+struct Segment {
+  double time; // frame.time_relative
+  FlowKey key;
+  uint16_t ipLength;
+  uint16_t tcpLength;
+};
+
+// Read-only memory map of a whole file
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("Could not open file: " + filename);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw std::runtime_error("Could not stat file: " + filename);
+    }
+    m_size = st.st_size;
+    m_data = nullptr;
+    if (m_size > 0) {
+      void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Could not map file: " + filename);
+      }
+      madvise(data, m_size, MADV_SEQUENTIAL);
+      m_data = static_cast<const uint8_t *>(data);
+    }
+    close(fd);
+  }
+
+  ~MappedFile() {
+    if (m_data)
+      munmap(const_cast<uint8_t *>(m_data), m_size);
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const uint8_t *Data() const { return m_data; }
+  size_t Size() const { return m_size; }
+
+private:
+  const uint8_t *m_data;
+  size_t m_size;
+};
+
+static uint16_t ReadBe16(const uint8_t *p) { return p[0] << 8 | p[1]; }
+
+static uint32_t ReadBe32(const uint8_t *p) {
+  return static_cast<uint32_t>(p[0]) << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static uint32_t ReadPcap32(const uint8_t *p, bool swapped) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return swapped ? __builtin_bswap32(value) : value;
+}
+
+// Returns the offset of the IPv4 header in a frame, or -1 if it has none
+static long IpOffset(uint32_t linkType, const uint8_t *frame, size_t length) {
+  switch (linkType) {
+  case LINKTYPE_ETHERNET: {
+    size_t offset = 12;
+    if (length < offset + 2)
+      return -1;
+    uint16_t etherType = ReadBe16(frame + offset);
+    while (etherType == ETHERTYPE_VLAN && length >= offset + 6) {
+      offset += 4;
+      etherType = ReadBe16(frame + offset);
+    }
+    return etherType == ETHERTYPE_IPV4 ? offset + 2 : -1;
+  }
+  case LINKTYPE_PPP:
+    // ns-3 writes the 2 byte protocol only, real captures may add 0xff03
+    if (length >= 4 && frame[0] == 0xff && frame[1] == 0x03)
+      return ReadBe16(frame + 2) == PPP_IPV4 ? 4 : -1;
+    return length >= 2 && ReadBe16(frame) == PPP_IPV4 ? 2 : -1;
+  case LINKTYPE_RAW:
+  case LINKTYPE_IPV4:
+    return length > 0 && (frame[0] >> 4) == 4 ? 0 : -1;
+  case LINKTYPE_LINUX_SLL:
+    return length >= 16 && ReadBe16(frame + 14) == ETHERTYPE_IPV4 ? 16 : -1;
+  case LINKTYPE_LINUX_SLL2:
+    return length >= 20 && ReadBe16(frame) == ETHERTYPE_IPV4 ? 20 : -1;
+  default:
+    throw std::runtime_error("Unsupported pcap link type " +
+                             std::to_string(linkType));
+  }
+}
+
+// Collects the TCP data segments from `srcPort` in a pcap. With portsOnly
+// the addresses are left out of the key, like the Python matcher does.
+static std::vector<Segment> ReadSegments(const MappedFile &file,
+                                         uint16_t srcPort, bool portsOnly) {
+  const uint8_t *data = file.Data();
+  size_t size = file.Size();
+  if (size < 24)
+    throw std::runtime_error("File too short for a pcap header");
+
+  uint32_t magic;
+  std::memcpy(&magic, data, sizeof(magic));
+  bool swapped = false;
+  double tickSeconds;
+  if (magic == PCAP_MAGIC_US || magic == __builtin_bswap32(PCAP_MAGIC_US)) {
+    swapped = magic != PCAP_MAGIC_US;
+    tickSeconds = 1e-6;
+  } else if (magic == PCAP_MAGIC_NS ||
+             magic == __builtin_bswap32(PCAP_MAGIC_NS)) {
+    swapped = magic != PCAP_MAGIC_NS;
+    tickSeconds = 1e-9;
+  } else {
+    throw std::runtime_error("Not a pcap file (pcapng is not supported)");
+  }
+  uint32_t linkType = ReadPcap32(data + 20, swapped) & 0x0fffffff;
+
+  std::vector<Segment> segments;
+  segments.reserve(size / 1500);
+
+  double firstTime = -1.0;
+  size_t offset = 24;
+  while (offset + 16 <= size) {
+    const uint8_t *record = data + offset;
+    double time = ReadPcap32(record, swapped) +
+                  ReadPcap32(record + 4, swapped) * tickSeconds;
+    uint32_t capturedLength = ReadPcap32(record + 8, swapped);
+    offset += 16;
+    if (offset + capturedLength > size)
+      break; // truncated last record
+    const uint8_t *frame = data + offset;
+    offset += capturedLength;
+
+    if (firstTime < 0)
+      firstTime = time;
+
+    long ipOffset = IpOffset(linkType, frame, capturedLength);
+    if (ipOffset < 0 || capturedLength < ipOffset + 20)
+      continue;
+    const uint8_t *ip = frame + ipOffset;
+    size_t ipHeaderLength = (ip[0] & 0x0f) * 4;
+    if (ip[9] != IP_PROTOCOL_TCP ||
+        capturedLength < ipOffset + ipHeaderLength + 20)
+      continue;
+    const uint8_t *tcp = ip + ipHeaderLength;
+
+    Segment segment;
+    segment.key.srcPort = ReadBe16(tcp);
+    if (segment.key.srcPort != srcPort)
+      continue;
+    segment.ipLength = ReadBe16(ip + 2);
+    size_t tcpHeaderLength = (tcp[12] >> 4) * 4;
+    if (segment.ipLength <= ipHeaderLength + tcpHeaderLength)
+      continue; // no payload, e.g. the SYN
+    segment.tcpLength = segment.ipLength - ipHeaderLength - tcpHeaderLength;
+
+    segment.time = time - firstTime;
+    segment.key.srcIp = portsOnly ? 0 : ReadBe32(ip + 12);
+    segment.key.dstIp = portsOnly ? 0 : ReadBe32(ip + 16);
+    segment.key.dstPort = ReadBe16(tcp + 2);
+    segment.key.seq = ReadBe32(tcp + 4);
+    segments.push_back(segment);
+  }
+  return segments;
+}
+
+// Open-addressing (linear probing) table from a segment key to what is
+// known about its transmissions and receptions.
+class SegmentTable {
+public:
+  struct Entry {
+    FlowKey key;
+    bool used;
+    uint32_t transmissions;
+    double lastReception; // latest client arrival, -1 if never received
+    double latestBefore;  // latest transmission before lastReception
+    size_t latestBeforeIndex;
+  };
+
+  explicit SegmentTable(size_t expected) {
+    size_t capacity = 16;
+    while (capacity < expected * 2)
+      capacity <<= 1;
+    m_mask = capacity - 1;
+    m_entries.assign(capacity, Entry());
+    for (auto &entry : m_entries)
+      entry.used = false;
+  }
+
+  Entry &Insert(const FlowKey &key) {
+    size_t slot = Hash(key) & m_mask;
+    while (m_entries[slot].used && !(m_entries[slot].key == key))
+      slot = (slot + 1) & m_mask;
+    Entry &entry = m_entries[slot];
+    if (!entry.used) {
+      entry.used = true;
+      entry.key = key;
+      entry.transmissions = 0;
+      entry.lastReception = -1.0;
+      entry.latestBefore = -std::numeric_limits<double>::infinity();
+      entry.latestBeforeIndex = std::numeric_limits<size_t>::max();
+    }
+    return entry;
+  }
+
+  Entry *Find(const FlowKey &key) {
+    size_t slot = Hash(key) & m_mask;
+    while (m_entries[slot].used) {
+      if (m_entries[slot].key == key)
+        return &m_entries[slot];
+      slot = (slot + 1) & m_mask;
+    }
+    return nullptr;
+  }
+
+private:
+  static uint64_t Hash(const FlowKey &key) {
+    // splitmix64 finaliser over the packed key
+    uint64_t x = (static_cast<uint64_t>(key.srcIp) << 32 | key.dstIp) ^
+                 (static_cast<uint64_t>(key.srcPort) << 48 |
+                  static_cast<uint64_t>(key.dstPort) << 32 | key.seq) *
+                     0x9e3779b97f4a7c15ULL;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+  }
+
+  std::vector<Entry> m_entries;
+  size_t m_mask;
+};
+
+static std::vector<bool> MatchLosses(const std::vector<Segment> &server,
+                                     const std::vector<Segment> &client) {
+  SegmentTable table(server.size());
+  for (const Segment &segment : server)
+    table.Insert(segment.key).transmissions++;
+
+  for (const Segment &segment : client) {
+    SegmentTable::Entry *entry = table.Find(segment.key);
+    if (entry)
+      entry->lastReception = segment.time;
+  }
+
+  // the latest transmission before the last arrival is the delivered one;
+  // strict comparison keeps the first of equal times, like idxmax
+  for (size_t i = 0; i < server.size(); i++) {
+    SegmentTable::Entry *entry = table.Find(server[i].key);
+    if (entry->transmissions > 1 && server[i].time < entry->lastReception &&
+        server[i].time > entry->latestBefore) {
+      entry->latestBefore = server[i].time;
+      entry->latestBeforeIndex = i;
+    }
+  }
+
+  std::vector<bool> lost(server.size());
+  for (size_t i = 0; i < server.size(); i++) {
+    SegmentTable::Entry *entry = table.Find(server[i].key);
+    if (entry->lastReception < 0)
+      lost[i] = true;
+    else if (entry->transmissions > 1)
+      lost[i] = server[i].time < entry->lastReception &&
+                i != entry->latestBeforeIndex;
+    else
+      lost[i] = false;
+  }
+  return lost;
+}
+
+static void WriteCsv(const std::string &filename,
+                     const std::vector<Segment> &server,
+                     const std::vector<bool> &lost) {
+  FILE *out = std::fopen(filename.c_str(), "w");
+  if (!out)
+    throw std::runtime_error("Could not open output file: " + filename);
+  std::vector<char> buffer(1 << 20);
+  std::setvbuf(out, buffer.data(), _IOFBF, buffer.size());
+  std::fprintf(out, "timestamp,pkt_len,seq,is_lost\n");
+  for (size_t i = 0; i < server.size(); i++)
+    std::fprintf(out, "%.9f,%u,%u,%d\n", server[i].time, server[i].ipLength,
+                 server[i].key.seq, lost[i] ? 1 : 0);
+  std::fclose(out);
+}
+
+static void WriteBinary(const std::string &filename,
+                        const std::vector<Segment> &server,
+                        const std::vector<bool> &lost) {
+  std::vector<LossRecord> records(server.size());
+  for (size_t i = 0; i < server.size(); i++) {
+    std::memset(&records[i], 0, sizeof(LossRecord));
+    records[i].timestamp = server[i].time;
+    records[i].pktLen = server[i].ipLength;
+    records[i].seq = server[i].key.seq;
+    records[i].isLost = lost[i];
+  }
+  FILE *out = std::fopen(filename.c_str(), "wb");
+  if (!out)
+    throw std::runtime_error("Could not open output file: " + filename);
+  std::fwrite(records.data(), sizeof(LossRecord), records.size(), out);
+  std::fclose(out);
+}
+
+static void Usage(const char *name) {
+  std::fprintf(stderr,
+               "Usage: %s --server-port PORT [--ports-only] [--binary] "
+               "SERVER_PCAP CLIENT_PCAP OUTPUT\n",
+               name);
+}
+
+int main(int argc, char *argv[]) {
+  long serverPort = -1;
+  bool portsOnly = false;
+  bool binary = false;
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--server-port" && i + 1 < argc)
+      serverPort = std::strtol(argv[++i], nullptr, 10);
+    else if (arg == "--ports-only")
+      portsOnly = true;
+    else if (arg == "--binary")
+      binary = true;
+    else
+      files.push_back(arg);
+  }
+  if (serverPort < 0 || serverPort > 0xffff || files.size() != 3) {
+    Usage(argv[0]);
+    return 2;
+  }
+
+  try {
+    MappedFile serverFile(files[0]);
+    MappedFile clientFile(files[1]);
+    std::vector<Segment> server =
+        ReadSegments(serverFile, serverPort, portsOnly);
+    std::vector<Segment> client =
+        ReadSegments(clientFile, serverPort, portsOnly);
+
+    std::vector<bool> lost = MatchLosses(server, client);
+    if (binary)
+      WriteBinary(files[2], server, lost);
+    else
+      WriteCsv(files[2], server, lost);
+
+    size_t lostCount = 0;
+    for (bool isLost : lost)
+      lostCount += isLost;
+    std::fprintf(stderr, "server lost events: %zu of %zu\n", lostCount,
+                 server.size());
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
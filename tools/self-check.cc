@@ -0,0 +1,315 @@
+/*
+ * Known-answer checks of the simulation modules that do not need ns-3: the
+ * P-square quantile, the alias table, the sawtooth fast-forward, the
+ * convergence monitor, the flow table, the result record and the config hash.
+ * self_check.py builds and runs it, and then checks the Python side of the
+ * result store against the record it writes.
+ *
+ * It lives outside the simulation directory so ns-3 does not build it:
+ *
+ *   g++ -std=c++17 -I.. -o self-check self-check.cc ../rate-estimator.cc \
+ *      ../alias-table.cc ../fast-forward.cc ../convergence.cc \
+ *      ../flow-table.cc ../result-store.cc ../config-hash.cc
+ *   ./self-check [record.jsonl]
+ *
+ * With a file name, the record of the result record check is appended to
+ * it. Prints every failed check and exits with 1 if there was one.
+ */
+
+#include "alias-table.h"
+#include "config-hash.h"
+#include "convergence.h"
+#include "fast-forward.h"
+#include "flow-table.h"
+#include "rate-estimator.h"
+#include "result-store.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void Check(bool ok, const std::string &what) {
+  if (!ok) {
+    std::cout << "FAIL: " << what << std::endl;
+    failures++;
+  }
+}
+
+static void CheckNear(double value, double expected, double tolerance,
+                      const std::string &what) {
+  Check(std::fabs(value - expected) <= tolerance,
+        what + ": " + std::to_string(value) + ", expected " +
+            std::to_string(expected));
+}
+
+// deterministic uniform [0, 1) sequence, the same on every platform
+static double NextUniform(uint64_t &state) {
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void CheckQuantile() {
+  // the worked example of Jain & Chlamtac (1985), whose median estimate
+  // after the 20 observations is 4.44
+  const double observations[] = {0.02,  0.15,  0.74,  3.39,  0.83,
+                                 22.37, 10.15, 15.43, 38.62, 15.92,
+                                 34.60, 10.28, 1.47,  0.40,  0.05,
+                                 11.39, 0.27,  0.42,  0.09,  11.37};
+  StreamingQuantile median(0.5);
+  for (double value : observations)
+    median.Add(value);
+  CheckNear(median.Get(), 4.44, 0.005, "P-square median of the paper");
+  Check(median.GetCount() == 20, "P-square sample count");
+
+  // exact while there are fewer than five samples
+  StreamingQuantile small(0.5);
+  for (double value : {3.0, 1.0, 2.0})
+    small.Add(value);
+  CheckNear(small.Get(), 2.0, 1e-12, "P-square median of 3 samples");
+
+  StreamingQuantile empty(0.5);
+  CheckNear(empty.Get(), 0.0, 0.0, "P-square without samples");
+
+  // uniform samples, the quantiles are the quantile levels
+  uint64_t state = 1;
+  StreamingQuantile q50(0.5), q90(0.9);
+  for (int i = 0; i < 100000; i++) {
+    double value = NextUniform(state);
+    q50.Add(value);
+    q90.Add(value);
+  }
+  CheckNear(q50.Get(), 0.5, 0.01, "P-square median of uniform samples");
+  CheckNear(q90.Get(), 0.9, 0.01, "P-square 0.9 quantile of uniform samples");
+}
+
+static void CheckAliasTable() {
+  // 100 once, 200 twice, 1500 five times
+  AliasTable table({1500, 100, 1500, 200, 1500, 1500, 200, 1500});
+  Check(table.GetValueCount() == 3, "alias table distinct values");
+
+  // the midpoints of a fine grid over (u1, u2) give the exact frequencies
+  const int steps = 1000;
+  std::map<uint32_t, int> draws;
+  for (int i = 0; i < steps; i++) {
+    for (int j = 0; j < steps; j++)
+      draws[table.Draw((i + 0.5) / steps, (j + 0.5) / steps)]++;
+  }
+  double total = static_cast<double>(steps) * steps;
+  Check(draws.size() == 3, "alias table draws only sampled values");
+  CheckNear(draws[100] / total, 1.0 / 8, 1e-3, "alias frequency of 100");
+  CheckNear(draws[200] / total, 2.0 / 8, 1e-3, "alias frequency of 200");
+  CheckNear(draws[1500] / total, 5.0 / 8, 1e-3, "alias frequency of 1500");
+
+  AliasTable single({576, 576});
+  Check(single.Draw(0.0, 0.999) == 576 && single.Draw(0.999, 0.0) == 576,
+        "alias table of a single value");
+}
+
+static void CheckFastForward() {
+  // a loss every second from t=1, a second one within the RTT, then ten
+  // 1000-byte packets
+  SawtoothFastForward forward(4, 0.05);
+  forward.RttChanged(0.0, 0.01);
+  for (int cycle = 1; cycle <= 5; cycle++) {
+    bool stable = forward.PacketLost(cycle);
+    Check(stable == (cycle == 5),
+          "fast-forward stable after four cycles, loss " +
+              std::to_string(cycle));
+    if (stable)
+      break;
+    Check(!forward.PacketLost(cycle + 0.005),
+          "fast-forward loss within an RTT starts no cycle");
+    for (int i = 0; i < 10; i++)
+      forward.PacketDelivered(cycle + 0.05 + 0.1 * i, 1000);
+  }
+
+  // from the loss at 5 s to 7.5 s: the rest of the cycle at 5 s, the cycle
+  // at 6 s and half of the one at 7 s
+  RateEstimators estimators;
+  forward.FastForward(5.0, 7.5, estimators);
+  Check(forward.IsForwarded(), "fast-forward forwarded");
+  Check(forward.GetForwardedPackets() == 25, "fast-forwarded packets");
+  Check(forward.GetForwardedBytes() == 25000, "fast-forwarded bytes");
+  std::ostringstream metadata;
+  forward.WriteMetadata(metadata);
+  Check(metadata.str() == "fast_forward_start=5\nfast_forward_end=7.5\n"
+                          "fast_forward_cycles=3\nfast_forward_bytes=25000\n"
+                          "fast_forward_losses=5\n",
+        "fast-forward metadata: " + metadata.str());
+
+  // one cycle 10% longer than the others is not stable
+  SawtoothFastForward uneven(4, 0.05);
+  uneven.RttChanged(0.0, 0.01);
+  double loss = 1.0;
+  for (int cycle = 1; cycle <= 5; cycle++) {
+    Check(!uneven.PacketLost(loss), "fast-forward uneven cycles");
+    for (int i = 0; i < 10; i++)
+      uneven.PacketDelivered(loss + 0.05 + 0.1 * i, 1000);
+    loss += cycle == 3 ? 1.1 : 1.0;
+  }
+}
+
+static void CheckConvergence() {
+  ConvergenceMonitor monitor;
+  Check(!monitor.IsStopped() && monitor.GetStopReason() == "end",
+        "convergence not stopped at first");
+
+  // within 1% of the previous estimate at three losses in a row; the jump
+  // to 150 starts the count again
+  monitor.Configure(0.01, 3, 0);
+  const double rates[] = {100, 100.5, 150, 150.5, 151, 151.5};
+  for (int i = 0; i < 6; i++) {
+    bool stop = monitor.PacketLost(i + 1.0, rates[i]);
+    Check(stop == (i == 5), "convergence at loss " + std::to_string(i));
+  }
+  Check(monitor.GetStopReason() == "converged", "convergence reason");
+  CheckNear(monitor.GetStopTime(), 6.0, 0, "convergence stop time");
+  Check(!monitor.PacketLost(7.0, 151.5), "convergence stops once");
+  std::ostringstream metadata;
+  monitor.WriteMetadata(metadata);
+  Check(metadata.str() == "stop_reason=converged\nstop_time=6\n",
+        "convergence metadata: " + metadata.str());
+
+  // 2 s of deliveries without a drop, counted from the last loss
+  ConvergenceMonitor drops;
+  drops.Configure(0, 15, 2.0);
+  Check(!drops.PacketDelivered(1.0) && !drops.PacketDelivered(2.9),
+        "no drop timeout before 2 s");
+  Check(!drops.PacketLost(3.0, 100), "drop timeout ignores the rate");
+  Check(!drops.PacketDelivered(5.0), "no drop timeout at exactly 2 s");
+  Check(drops.PacketDelivered(5.1) && drops.GetStopReason() == "no_drops",
+        "drop timeout after 2 s");
+
+  ConvergenceMonitor off;
+  for (int i = 0; i < 100; i++) {
+    Check(!off.PacketLost(i, 100) && !off.PacketDelivered(i + 0.5),
+          "convergence off by default");
+  }
+}
+
+static void CheckFlowTable() {
+  FlowTable table(3);
+  table.PacketDelivered(0, 1.0, 1000);
+  table.PacketDelivered(0, 2.0, 1000);
+  table.PacketDelivered(1, 1.0, 500);
+  table.PacketDelivered(1, 3.0, 1500);
+  table.PacketLost(1, 2.5);
+  table.PacketLost(1, 2.7);
+  // out of range flows are ignored
+  table.PacketDelivered(7, 1.0, 1000);
+  table.PacketLost(7, 1.0);
+
+  Check(table.GetDeliveredBytes(0) == 2000, "flow 0 bytes");
+  Check(table.GetLossCount(1) == 2, "flow 1 losses");
+  CheckNear(table.GetRate(0), 16000, 1e-9, "flow 0 rate");
+  CheckNear(table.GetRate(1), 8000, 1e-9, "flow 1 rate");
+  CheckNear(table.GetRate(2), 0, 0, "rate of a flow without packets");
+  Check(table.GetTotalBytes() == 4000, "aggregate bytes");
+  Check(table.GetTotalLosses() == 2, "aggregate losses");
+  // (16000 + 8000)^2 / (3 * (16000^2 + 8000^2))
+  CheckNear(table.GetFairness(), 0.6, 1e-12, "fairness index");
+
+  std::string filename = "self-check-flows.csv";
+  table.WriteCsv(filename);
+  std::ifstream file(filename);
+  std::string header, row;
+  std::getline(file, header);
+  std::getline(file, row);
+  Check(header ==
+            "flow,rx_bytes,rx_packets,losses,first_rx,last_rx,first_loss,rate",
+        "flow CSV header");
+  Check(row == "0,2000,2,0,1,2,-1,16000", "flow CSV row: " + row);
+  file.close();
+  std::remove(filename.c_str());
+
+  table.Reset();
+  Check(table.GetFlowCount() == 3 && table.GetTotalBytes() == 0,
+        "flow table reset");
+}
+
+static ResultRecord MakeRecord() {
+  ResultRecord record("self-check", "check \"1\"");
+  record.SetSeed(3, 7);
+  record.SetConfigHash("0123456789abcdef");
+  record.SetParameter("burst", 12000);
+  record.SetParameter("queueSize", "1500B");
+  record.SetParameter("burst", 15000);
+  record.SetParameter("rate", std::nan(""));
+  record.SetFile("metadata", "data/self-check\tmetadata");
+  return record;
+}
+
+static void CheckResultRecord(const char *store) {
+  ResultRecord record = MakeRecord();
+  Check(record.ToJson() ==
+            "{\"scenario\":\"self-check\",\"run_id\":\"check \\\"1\\\"\","
+            "\"seed\":3,\"run\":7,\"config_hash\":\"0123456789abcdef\","
+            "\"params\":{\"burst\":15000,\"queueSize\":\"1500B\","
+            "\"rate\":null},\"results\":{},"
+            "\"files\":{\"metadata\":\"data/self-check\\tmetadata\"}}",
+        "result record JSON: " + record.ToJson());
+
+  // the record is one line, read back as it was written
+  std::string filename = "self-check-results.jsonl";
+  std::remove(filename.c_str());
+  record.Append(filename);
+  record.Append(filename);
+  std::ifstream file(filename);
+  std::string line;
+  int lines = 0;
+  while (std::getline(file, line)) {
+    Check(line == record.ToJson(), "appended result record");
+    lines++;
+  }
+  Check(lines == 2, "appended result records");
+  file.close();
+  std::remove(filename.c_str());
+
+  if (store)
+    record.Append(store);
+}
+
+static std::string HashOf(const std::vector<std::string> &values) {
+  ConfigHash hash;
+  for (const auto &value : values)
+    hash.Add(value);
+  return hash.ToString();
+}
+
+static void CheckConfigHash() {
+  // FNV-1a, every value followed by a 0xff terminator
+  Check(HashOf({}) == "cbf29ce484222325", "hash of nothing");
+  Check(HashOf({"a"}) == "089bc907b544c769", "hash of \"a\"");
+  std::vector<std::string> argv = {"--burst=12000", "--queueSize=1500B"};
+  Check(HashOf(argv) == "bae1700d91ccf71a", "hash of a command line");
+  Check(HashOf(argv) == HashOf(argv), "hash of the same command line");
+  Check(HashOf({"ab", "c"}) != HashOf({"a", "bc"}),
+        "hash keeps values apart");
+  Check(HashOf({"--burst=12000", "--queueSize=1500B"}) !=
+            HashOf({"--queueSize=1500B", "--burst=12000"}),
+        "hash depends on the order");
+}
+
+int main(int argc, char *argv[]) {
+  CheckQuantile();
+  CheckAliasTable();
+  CheckFastForward();
+  CheckConvergence();
+  CheckFlowTable();
+  CheckResultRecord(argc > 1 ? argv[1] : nullptr);
+  CheckConfigHash();
+
+  if (failures > 0) {
+    std::cout << failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "All checks passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include "trace-sink.h"
+
+#include <sstream>
+#include <stdexcept>
+
+TraceSink::TraceSink(size_t chunkRecords, size_t chunks)
+    : m_chunkRecords(chunkRecords), m_current(nullptr), m_closing(false),
+      m_file(nullptr) {
+  for (size_t i = 0; i < chunks; i++) {
+    m_chunks.emplace_back(new Chunk());
+    m_chunks.back()->records.resize(m_chunkRecords);
+    m_chunks.back()->size = 0;
+    m_free.push_back(m_chunks.back().get());
+  }
+}
+
+TraceSink::~TraceSink() { Close(); }
+
+void TraceSink::Open(const std::string &filename) {
+  Close();
+  m_file = std::fopen(filename.c_str(), "w");
+  if (!m_file) {
+    throw std::runtime_error("Could not open trace file: " + filename);
+  }
+
+  m_closing = false;
+  m_current = TakeFreeChunk();
+  m_writer = std::thread(&TraceSink::Run, this);
+}
+
+bool TraceSink::IsOpen() const { return m_file != nullptr; }
+
+void TraceSink::Write(double time, uint32_t value) {
+  Record record;
+  record.time = time;
+  record.value.integer = value;
+  record.isInteger = true;
+  Append(record);
+}
+
+void TraceSink::Write(double time, double value) {
+  Record record;
+  record.time = time;
+  record.value.real = value;
+  record.isInteger = false;
+  Append(record);
+}
+
+void TraceSink::Append(const Record &record) {
+  // like writing to a closed std::ofstream, records outside a run are lost
+  if (!m_current)
+    return;
+  m_current->records[m_current->size++] = record;
+  if (m_current->size == m_chunkRecords)
+    Submit();
+}
+
+void TraceSink::Submit() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_full.push_back(m_current);
+  if (m_free.empty()) {
+    // the writer is behind, grow instead of waiting for it
+    m_chunks.emplace_back(new Chunk());
+    m_chunks.back()->records.resize(m_chunkRecords);
+    m_free.push_back(m_chunks.back().get());
+  }
+  m_current = m_free.front();
+  m_current->size = 0;
+  m_free.pop_front();
+  m_ready.notify_one();
+}
+
+TraceSink::Chunk *TraceSink::TakeFreeChunk() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Chunk *chunk = m_free.front();
+  m_free.pop_front();
+  chunk->size = 0;
+  return chunk;
+}
+
+void TraceSink::Run() {
+  // default stream formatting, so the bytes match the old std::ofstream
+  std::ostringstream text;
+  while (true) {
+    Chunk *chunk;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_ready.wait(lock, [this] { return !m_full.empty() || m_closing; });
+      if (m_full.empty())
+        return;
+      chunk = m_full.front();
+      m_full.pop_front();
+    }
+
+    text.str("");
+    for (size_t i = 0; i < chunk->size; i++) {
+      const Record &record = chunk->records[i];
+      text << record.time << ",";
+      if (record.isInteger)
+        text << record.value.integer;
+      else
+        text << record.value.real;
+      text << "\n";
+    }
+    const std::string &block = text.str();
+    std::fwrite(block.data(), 1, block.size(), m_file);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.push_back(chunk);
+  }
+}
+
+void TraceSink::Close() {
+  if (!m_file)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_current->size > 0)
+      m_full.push_back(m_current);
+    else
+      m_free.push_back(m_current);
+    m_current = nullptr;
+    m_closing = true;
+  }
+  // the writer drains the remaining chunks before it stops
+  m_ready.notify_one();
+  m_writer.join();
+
+  std::fclose(m_file);
+  m_file = nullptr;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writer of a "time,value" trace (cwnd, RTT, RTO) that keeps file I/O off
+// the simulator thread. Write() only appends a fixed-size record to a
+// preallocated chunk; full chunks are handed to a background thread that
+// formats them exactly like `file << time << "," << value << std::endl`
+// and writes them in large blocks. If the writer falls behind, a new chunk
+// is allocated instead of waiting for it.
+class TraceSink {
+public:
+  explicit TraceSink(size_t chunkRecords = 4096, size_t chunks = 8);
+  ~TraceSink();
+
+  TraceSink(const TraceSink &) = delete;
+  TraceSink &operator=(const TraceSink &) = delete;
+
+  void Open(const std::string &filename);
+  bool IsOpen() const;
+
+  void Write(double time, uint32_t value);
+  void Write(double time, double value);
+
+  // Writes out everything recorded so far and closes the file
+  void Close();
+
+private:
+  struct Record {
+    double time;
+    union {
+      double real;
+      uint64_t integer;
+    } value;
+    bool isInteger;
+  };
+
+  struct Chunk {
+    std::vector<Record> records;
+    size_t size;
+  };
+
+  void Append(const Record &record);
+  void Submit();
+  Chunk *TakeFreeChunk();
+  void Run();
+
+  size_t m_chunkRecords;
+  std::vector<std::unique_ptr<Chunk>> m_chunks; // owns every chunk
+  Chunk *m_current;
+
+  std::mutex m_mutex;
+  std::condition_variable m_ready;
+  std::deque<Chunk *> m_full;
+  std::deque<Chunk *> m_free;
+  bool m_closing;
+
+  FILE *m_file;
+  std::thread m_writer;
+};
@@ -1,55 +1,177 @@
 #include "utils.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/global-value.h"
 #include "ns3/point-to-point-module.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/system-path.h"
+#include "ns3/type-id.h"
+#include "ns3/uinteger.h"
+#include "packet-event-log.h"
+#include "policer-queue-disc.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+
+// Both can be set on any simulation's command line (--OutputRoot=...,
+// --RunId=...) or through NS_GLOBAL_VALUE, so that concurrent runs of the
+// same parameters do not write to the same files.
+static GlobalValue g_outputRoot(
+    "OutputRoot", "Directory all per-run output files are written to",
+    StringValue("scratch/Traffic-Policing-Inference-Simulation/data/"),
+    MakeStringChecker());
+
+static GlobalValue g_runId(
+    "RunId", "Identifier added to every per-run output file name",
+    StringValue(""), MakeStringChecker());
+
+// --Pcap=0 turns off the full pcaps, --EventLog=1 writes the compact binary
+// event log of the same two devices (see packet-event-log.h) instead.
+static GlobalValue g_pcap("Pcap", "Write full pcaps of the capture devices",
+                          BooleanValue(true), MakeBooleanChecker());
+
+static GlobalValue g_eventLog(
+    "EventLog", "Write binary per-packet event logs of the capture devices",
+    BooleanValue(false), MakeBooleanChecker());
+
+// --QueueDisc=ns3::PolicerQueueDisc (or ns3::ClassPolicerQueueDisc)
+// replaces TBF on the bottleneck. PolicerQueueDisc takes the same
+// MaxSize/Burst/Mtu/Rate/PeakRate attributes; ClassPolicerQueueDisc uses
+// MaxSize, Burst and Rate as the defaults of its classes and accepts Mtu
+// and PeakRate only for compatibility (PeakRate must be 0).
+static GlobalValue g_queueDisc(
+    "QueueDisc", "TypeId of the queue disc that polices the bottleneck",
+    StringValue("ns3::TbfQueueDisc"), MakeStringChecker());
+
+// --FastForward=1 ends the packet-level simulation once the loss cycles
+// repeat and replays the last cycle instead (see fast-forward.h).
+static GlobalValue g_fastForward(
+    "FastForward", "Replay the steady-state sawtooth instead of simulating it",
+    BooleanValue(false), MakeBooleanChecker());
+
+// Early stop of a run (see convergence.h): --ConvergenceThreshold=0.01 ends
+// it once the GOOGLE estimate moves less than 1% over ConvergenceLosses
+// losses, --DropTimeout=2 once nothing was dropped for 2 s. 0 turns either off.
+static GlobalValue g_convergenceThreshold(
+    "ConvergenceThreshold", "Relative change of the rate estimate to stop at",
+    DoubleValue(0), MakeDoubleChecker<double>(0));
+
+static GlobalValue g_convergenceLosses(
+    "ConvergenceLosses", "Losses the estimate has to stay within the threshold",
+    UintegerValue(15), MakeUintegerChecker<uint32_t>(1));
+
+static GlobalValue g_dropTimeout(
+    "DropTimeout", "Seconds without a drop after which a run is stopped",
+    DoubleValue(0), MakeDoubleChecker<double>(0));
+
+// --DrainDetection=0 brings back the fixed 5 s tail after the applications
+// stop, otherwise runs end once the network is empty (see drain-detector.h).
+static GlobalValue g_drainDetection(
+    "DrainDetection", "Stop once the network drained after the applications",
+    BooleanValue(true), MakeBooleanChecker());
+
+// --SkipCompleted=0 reruns points the result store already has
+static GlobalValue g_skipCompleted(
+    "SkipCompleted", "Skip runs whose configuration is in the result store",
+    BooleanValue(true), MakeBooleanChecker());
+
+// --LinkRate=1Gbps replaces the rate of a scenario's access links, so the
+// cost of a run can be compared across link speeds (see benchmark.py).
+static GlobalValue g_linkRate(
+    "LinkRate", "Rate of the scenario's access links, empty for its own",
+    StringValue(""), MakeStringChecker());
+
+static std::vector<std::unique_ptr<PacketEventLog>> eventLogs;
+
+static ConfigHash baseConfigHash;
+
+// config hashes in the result store, read on the first isCompleted
+static std::unordered_set<std::string> completedHashes;
+static bool completedHashesLoaded = false;
+
+std::string getOutputRoot() {
+  StringValue root;
+  g_outputRoot.GetValue(root);
+  std::string dir = root.Get();
+  if (!dir.empty() && dir.back() != '/') {
+    dir += "/";
+  }
+  if (!dir.empty()) {
+    SystemPath::MakeDirectories(dir);
+  }
+  return dir;
+}
+
+std::string getRunId() {
+  StringValue runId;
+  g_runId.GetValue(runId);
+  return runId.Get();
+}
 
 void assignFiles(PointToPointHelper pp1, PointToPointHelper pp2, Ptr<NetDevice> d1, Ptr<NetDevice> d2,
                  std::string name, std::vector<std::string> &args) {
   AsciiTraceHelper ascii;
 
-  std::string traceFileNameBase =
-      "scratch/Traffic-Policing-Inference-Simulation/data/wehe_sim_";
   std::string clientSide = "n0-n1";
   std::string serverSide = "n1-n2";
-  std::ostringstream traceFileNameStream;
+  std::string traceFileNameBase = getFilename("sim", name, args);
 
-  traceFileNameStream << traceFileNameBase << name << "_";
-  for (auto &arg : args) {
-    traceFileNameStream << arg << "_";
-  }
+  std::string pcapServerSide = traceFileNameBase + serverSide;
+  std::string traceFileServer = pcapServerSide + ".tr";
 
-  traceFileNameStream << serverSide;
-  std::string pcapServerSide = traceFileNameStream.str();
-  traceFileNameStream << ".tr";
-  std::string traceFileServer = traceFileNameStream.str();
+  std::string pcapClientSide = traceFileNameBase + clientSide;
+  std::string traceFileClient = pcapClientSide + ".tr";
 
-  traceFileNameStream.str(""); // reset buffer
-  traceFileNameStream.clear();
+  // pp1.EnableAsciiAll(ascii.CreateFileStream(traceFileServer));
+  // pp2.EnableAsciiAll(ascii.CreateFileStream(traceFileClient));
+  BooleanValue pcap, eventLog;
+  g_pcap.GetValue(pcap);
+  g_eventLog.GetValue(eventLog);
 
-  traceFileNameStream << traceFileNameBase << name << "_";
-  for (auto &arg : args) {
-    traceFileNameStream << arg << "_";
+  if (pcap.Get()) {
+    pp1.EnablePcap(pcapServerSide, d1, true);
+    pp2.EnablePcap(pcapClientSide, d2, true);
   }
+  if (eventLog.Get()) {
+    eventLogs.emplace_back(
+        new PacketEventLog(getEventLogFileName(pcapServerSide, d1)));
+    eventLogs.back()->Attach(d1);
+    eventLogs.emplace_back(
+        new PacketEventLog(getEventLogFileName(pcapClientSide, d2)));
+    eventLogs.back()->Attach(d2);
+  }
+}
 
-  traceFileNameStream << clientSide;
-  std::string pcapClientSide = traceFileNameStream.str();
-  traceFileNameStream << ".tr";
-  std::string traceFileClient = traceFileNameStream.str();
-
-  // pp1.EnableAsciiAll(ascii.CreateFileStream(traceFileServer));
-  // pp2.EnableAsciiAll(ascii.CreateFileStream(traceFileClient));
-  pp1.EnablePcap(pcapServerSide, d1, true);
-  pp2.EnablePcap(pcapClientSide, d2, true);
+std::string getEventLogFileName(std::string prefix, Ptr<NetDevice> device) {
+  // same suffix as the pcap of the device, so both are found the same way
+  std::ostringstream fileNameStream;
+  fileNameStream << prefix << "-" << device->GetNode()->GetId() << "-"
+                 << device->GetIfIndex() << ".events";
+  return fileNameStream.str();
 }
 
+void closeEventLogs() { eventLogs.clear(); }
+
 std::string getFilename(std::string fileContent, std::string simName,
                         std::vector<std::string> &args) {
-  std::string fileNameBase =
-      "scratch/Traffic-Policing-Inference-Simulation/data/wehe_";
+  std::string fileNameBase = getOutputRoot() + "wehe_";
   std::ostringstream fileNameStream;
 
   fileNameStream << fileNameBase << fileContent << "_" << simName << "_";
   for (auto &arg : args) {
     fileNameStream << arg << "_";
   }
+  std::string runId = getRunId();
+  if (!runId.empty()) {
+    fileNameStream << runId << "_";
+  }
   return fileNameStream.str();
 }
 
@@ -58,6 +180,156 @@ std::string getMetadataFileName(std::string simName,
   return getFilename("metadata", simName, args);
 }
 
+std::string getDroppedPacketsFileName(std::string simName,
+                                      std::vector<std::string> &args) {
+  return getFilename("dropped-packets", simName, args);
+}
+
+std::string getResultStoreFileName() {
+  // one store per output root, shared by all runs writing there
+  return getOutputRoot() + "wehe_results.jsonl";
+}
+
+void setBaseConfigHash(int argc, char *argv[],
+                       const std::vector<std::string> &pointOptions) {
+  ConfigHash hash;
+
+  // the build, by path, size and modification time of the binary
+  char path[4096];
+  ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+  std::string binaryPath =
+      length > 0 ? std::string(path, length) : std::string(argv[0]);
+  struct stat binary;
+  if (stat(binaryPath.c_str(), &binary) == 0) {
+    hash.Add(binaryPath);
+    hash.Add(std::to_string(binary.st_size));
+    hash.Add(std::to_string(binary.st_mtime));
+  }
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    std::string name = arg.substr(0, arg.find('='));
+    bool ignored = name == "--SkipCompleted";
+    for (const std::string &option : pointOptions)
+      ignored = ignored || name == "--" + option;
+    if (!ignored)
+      hash.Add(arg);
+  }
+
+  for (uint32_t i = 0; i < TypeId::GetRegisteredN(); i++) {
+    TypeId tid = TypeId::GetRegistered(i);
+    for (uint32_t j = 0; j < tid.GetAttributeN(); j++) {
+      TypeId::AttributeInformation info = tid.GetAttribute(j);
+      // pointers serialize to their address
+      if (info.checker->GetValueTypeName() == "ns3::PointerValue")
+        continue;
+      hash.Add(tid.GetName() + "::" + info.name + "=" +
+               info.initialValue->SerializeToString(info.checker));
+    }
+  }
+
+  for (auto it = GlobalValue::Begin(); it != GlobalValue::End(); ++it) {
+    if ((*it)->GetName() == "SkipCompleted")
+      continue;
+    Ptr<AttributeValue> value = (*it)->GetChecker()->Create();
+    (*it)->GetValue(*value);
+    hash.Add((*it)->GetName() + "=" +
+             value->SerializeToString((*it)->GetChecker()));
+  }
+
+  baseConfigHash = hash;
+}
+
+std::string getConfigHash(std::string simName,
+                          std::vector<std::string> &args) {
+  ConfigHash hash = baseConfigHash;
+  hash.Add(simName);
+  for (auto &arg : args)
+    hash.Add(arg);
+  return hash.ToString();
+}
+
+bool isCompleted(const std::string &configHash) {
+  BooleanValue skipCompleted;
+  g_skipCompleted.GetValue(skipCompleted);
+  if (!skipCompleted.Get())
+    return false;
+
+  if (!completedHashesLoaded) {
+    // records are only appended once a run has finished
+    std::ifstream store(getResultStoreFileName());
+    const std::string key = "\"config_hash\":\"";
+    std::string line;
+    while (std::getline(store, line)) {
+      size_t start = line.find(key);
+      if (start == std::string::npos)
+        continue;
+      start += key.size();
+      size_t end = line.find('"', start);
+      if (end != std::string::npos)
+        completedHashes.insert(line.substr(start, end - start));
+    }
+    completedHashesLoaded = true;
+  }
+  return completedHashes.count(configHash) > 0;
+}
+
+void appendResult(const ResultRecord &record) {
+  record.Append(getResultStoreFileName());
+  completedHashes.insert(record.GetConfigHash());
+}
+
+ResultRecord getResultRecord(std::string scenario, std::string simName,
+                             std::vector<std::string> &args) {
+  ResultRecord record(scenario, getRunId());
+  record.SetSeed(RngSeedManager::GetSeed(), RngSeedManager::GetRun());
+  record.SetConfigHash(getConfigHash(simName, args));
+  record.SetParameter("queueDisc", getQueueDiscType());
+  StringValue linkRate;
+  g_linkRate.GetValue(linkRate);
+  if (!linkRate.Get().empty()) {
+    record.SetParameter("linkRate", DataRate(linkRate.Get()).GetBitRate());
+  }
+  record.SetFile("sim", getFilename("sim", simName, args));
+  return record;
+}
+
+std::vector<SweepPoint> readSweepPoints(const std::string &filename) {
+  std::vector<SweepPoint> points;
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    throw std::runtime_error("Could not open sweep file: " + filename);
+  }
+
+  // One point per line: burst,queueSize[,trafficRatio]
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream lineStream(line);
+    std::string burst, queueSize, ratio;
+    std::getline(lineStream, burst, ',');
+    std::getline(lineStream, queueSize, ',');
+    std::getline(lineStream, ratio, ',');
+    if (burst.empty() || queueSize.empty()) {
+      throw std::runtime_error("Invalid sweep point in line: " + line);
+    }
+
+    try {
+      SweepPoint point;
+      point.burst = static_cast<uint32_t>(std::stoul(burst));
+      point.queueSize = queueSize;
+      point.trafficRatio = ratio.empty() ? 1.0 : std::stod(ratio);
+      points.push_back(point);
+    } catch (const std::exception &e) {
+      throw std::runtime_error("Invalid number in sweep line: " + line);
+    }
+  }
+
+  return points;
+}
+
 std::vector<uint32_t> readSizes(const std::string &filename) {
   std::vector<uint32_t> sizes;
   std::ifstream file(filename);
@@ -88,15 +360,85 @@ std::vector<uint32_t> readSizes(const std::string &filename) {
   return sizes;
 }
 
+std::string getPacketSizesFileName() {
+  return "scratch/Traffic-Policing-Inference-Simulation/send_data/"
+         "youtube_packets.csv";
+}
+
 std::vector<uint32_t> getPacketSizes() {
-  return readSizes("scratch/Traffic-Policing-Inference-Simulation/send_data/"
-                   "youtube_packets.csv");
+  return readSizes(getPacketSizesFileName());
 }
 
 void getTracerFiles(std::string simName, std::vector<std::string> &args,
-                    std::ofstream &cwndFile, std::ofstream &rttFile,
-                    std::ofstream &rtoFile) {
-  cwndFile.open(getFilename("cwnd", simName, args));
-  rttFile.open(getFilename("rtt", simName, args));
-  rtoFile.open(getFilename("rto", simName, args));
+                    TraceSink &cwndFile, TraceSink &rttFile,
+                    TraceSink &rtoFile) {
+  cwndFile.Open(getFilename("cwnd", simName, args));
+  rttFile.Open(getFilename("rtt", simName, args));
+  rtoFile.Open(getFilename("rto", simName, args));
+}
+
+bool getFastForward() {
+  BooleanValue fastForward;
+  g_fastForward.GetValue(fastForward);
+  return fastForward.Get();
+}
+
+bool getDrainDetection() {
+  BooleanValue drainDetection;
+  g_drainDetection.GetValue(drainDetection);
+  return drainDetection.Get();
+}
+
+void configureConvergence(ConvergenceMonitor &monitor) {
+  DoubleValue threshold, dropTimeout;
+  UintegerValue losses;
+  g_convergenceThreshold.GetValue(threshold);
+  g_convergenceLosses.GetValue(losses);
+  g_dropTimeout.GetValue(dropTimeout);
+  monitor.Configure(threshold.Get(), losses.Get(), dropTimeout.Get());
+}
+
+std::string getQueueDiscType() {
+  StringValue type;
+  g_queueDisc.GetValue(type);
+  return type.Get();
+}
+
+DataRate getLinkRate(DataRate defaultRate) {
+  StringValue rate;
+  g_linkRate.GetValue(rate);
+  return rate.Get().empty() ? defaultRate : DataRate(rate.Get());
+}
+
+double runAndPrintCost() {
+  auto wallStart = std::chrono::steady_clock::now();
+  Simulator::Run();
+  double wallTime = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - wallStart)
+                        .count();
+
+  // ru_maxrss is in kB on Linux, and the peak since the process started
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  std::cout << std::endl << "*** Run cost ***" << std::endl;
+  std::cout << "Events executed: " << Simulator::GetEventCount() << std::endl;
+  std::cout << "Simulated time: " << Simulator::Now().GetSeconds() << " s"
+            << std::endl;
+  std::cout << "Wall time: " << wallTime << " s" << std::endl;
+  std::cout << "Process peak RSS: " << usage.ru_maxrss << " kB" << std::endl;
+  return wallTime;
+}
+
+static void TokensTracer(TraceSink *tokensFile, Time time, double tokens) {
+  tokensFile->Write(time.GetSeconds(), tokens);
+}
+
+void getTokensFile(Ptr<QueueDisc> q, std::string simName,
+                   std::vector<std::string> &args, TraceSink &tokensFile) {
+  // only the policer has a sampled trace; TBF's per-change one is too dense
+  if (!DynamicCast<PolicerQueueDisc>(q))
+    return;
+  tokensFile.Open(getFilename("tokens", simName, args));
+  q->TraceConnectWithoutContext("TokensSample",
+                                MakeBoundCallback(&TokensTracer, &tokensFile));
 }
\ No newline at end of file
@@ -1,4 +1,9 @@
 #include "ns3/point-to-point-module.h"
+#include "ns3/queue-disc.h"
+#include "config-hash.h"
+#include "convergence.h"
+#include "result-store.h"
+#include "trace-sink.h"
 #include <string.h>
 #include <vector>
 
@@ -8,16 +13,88 @@ void assignFiles(PointToPointHelper pp1, PointToPointHelper pp2,
                  Ptr<NetDevice> d1, Ptr<NetDevice> d2, std::string name,
                  std::vector<std::string> &args);
 
+std::string getEventLogFileName(std::string prefix, Ptr<NetDevice> device);
+
+// Flushes and closes the event logs opened by assignFiles
+void closeEventLogs();
+
+std::string getOutputRoot();
+
+std::string getRunId();
+
 std::string getFilename(std::string fileContent, std::string simName,
                         std::vector<std::string> &args);
 
 std::string getMetadataFileName(std::string simName,
                                 std::vector<std::string> &args);
 
+std::string getDroppedPacketsFileName(std::string simName,
+                                      std::vector<std::string> &args);
+
+std::string getResultStoreFileName();
+
+// Hashes what every run of this process shares: the binary, the command
+// line without the `pointOptions` of a single point (and SkipCompleted),
+// every attribute default and every global value, RNG seed and run
+// included. Call after cmd.Parse and the main's own Config::SetDefault.
+void setBaseConfigHash(int argc, char *argv[],
+                       const std::vector<std::string> &pointOptions);
+
+// The base hash extended by one point, 16 hex digits
+std::string getConfigHash(std::string simName, std::vector<std::string> &args);
+
+// True when the result store already has a run of this configuration,
+// unless --SkipCompleted=0. The store is read once per process, runs
+// appended with appendResult are added as they finish.
+bool isCompleted(const std::string &configHash);
+
+// Appends a finished run to the result store
+void appendResult(const ResultRecord &record);
+
+// A record with the run id, RNG seed and run, queue disc and output file
+// prefix of a run; the main adds its parameters and metadata file.
+ResultRecord getResultRecord(std::string scenario, std::string simName,
+                             std::vector<std::string> &args);
+
+// One grid point of an in-process sweep (see readSweepPoints).
+struct SweepPoint {
+  uint32_t burst;
+  std::string queueSize;
+  double trafficRatio;
+};
+
+std::vector<SweepPoint> readSweepPoints(const std::string &filename);
+
 std::vector<uint32_t> readSizes(const std::string &filename);
 
+std::string getPacketSizesFileName();
+
 std::vector<uint32_t> getPacketSizes();
 
 void getTracerFiles(std::string simName, std::vector<std::string> &args,
-                    std::ofstream &cwndFile, std::ofstream &rttFile,
-                    std::ofstream &rtoFile);
\ No newline at end of file
+                    TraceSink &cwndFile, TraceSink &rttFile,
+                    TraceSink &rtoFile);
+
+bool getFastForward();
+
+bool getDrainDetection();
+
+// Applies the ConvergenceThreshold, ConvergenceLosses and DropTimeout values
+void configureConvergence(ConvergenceMonitor &monitor);
+
+std::string getQueueDiscType();
+
+// The LinkRate global value, or `defaultRate` when it is not set. Call after
+// cmd.Parse.
+DataRate getLinkRate(DataRate defaultRate);
+
+// Simulator::Run, then prints its cost (events executed, simulated and wall
+// seconds, peak RSS of the process) for benchmark.py. The RSS covers the whole
+// process so far, so after a sweep's later points it is the peak of all of
+// them. Returns the wall time in seconds.
+double runAndPrintCost();
+
+// Opens <tokens> and writes the TokensSample trace into it when q is a
+// PolicerQueueDisc, does nothing for other queue discs.
+void getTokensFile(Ptr<QueueDisc> q, std::string simName,
+                   std::vector<std::string> &args, TraceSink &tokensFile);
@@ -1,6 +1,8 @@
 from io import StringIO
 import math
+import os
 import subprocess
+import tempfile
 
 import pandas as pd
 import numpy as np
@@ -21,6 +23,70 @@ def pcap_to_df(pcap_path, fields, pkt_filter=None):
     return pd.read_csv(StringIO(output.decode('utf-8')))
 
 
+EVENT_LOG_MAGIC = b"WEHEEVT"
+EVENT_LOG_VERSION = 1
+EVENT_LOG_HEADER = np.dtype([('magic', 'S8'), ('version', '<u4'), ('record_size', '<u4')])
+# mirrors PacketEventRecord in packet-event-log.h
+EVENT_LOG_RECORD = np.dtype([
+    ('time_ns', '<i8'), ('flow', '<u4'), ('seq', '<u4'),
+    ('length', '<u2'), ('tcp_length', '<u2'),
+    ('tcp_flags', 'u1'), ('flags', 'u1'), ('reserved', '<u2')
+])
+EVENT_RETRANSMISSION = 0x01
+TCP_SYN = 0x02
+TCP_ACK = 0x10
+
+
+def event_log_path(pcap_path):
+    return pcap_path[:-len(".pcap")] + ".events" if pcap_path.endswith(".pcap") else pcap_path + ".events"
+
+
+def read_event_log(path):
+    """Maps the records of a binary event log written with --EventLog=1."""
+    header = np.fromfile(path, dtype=EVENT_LOG_HEADER, count=1)
+    if len(header) == 0 or header['magic'][0] != EVENT_LOG_MAGIC:
+        raise ValueError(f"{path} is not an event log")
+    if header['version'][0] != EVENT_LOG_VERSION or header['record_size'][0] != EVENT_LOG_RECORD.itemsize:
+        raise ValueError(f"{path} has an unsupported event log version")
+    if os.path.getsize(path) == EVENT_LOG_HEADER.itemsize:
+        return np.zeros(0, dtype=EVENT_LOG_RECORD)
+    return np.memmap(path, dtype=EVENT_LOG_RECORD, mode='r', offset=EVENT_LOG_HEADER.itemsize)
+
+
+def event_log_to_df(path, srcport=None):
+    """Event log as the columns pcap_to_df gives for the usual fields."""
+    records = read_event_log(path)
+    time = records['time_ns'] / 1e9
+    df = pd.DataFrame({
+        # like frame.time_relative, relative to the first packet of the capture
+        'time': time - time[0] if len(time) else time,
+        'seq': records['seq'],
+        'length': records['length'],
+        'tcp_length': records['tcp_length'],
+        'srcport': records['flow'] >> 16,
+        'dstport': records['flow'] & 0xffff,
+        'tcp_flags': records['tcp_flags'],
+        'is_retransmission': (records['flags'] & EVENT_RETRANSMISSION).astype(int),
+    })
+    if srcport is not None:
+        df = df[df['srcport'] == srcport].reset_index(drop=True)
+    return df
+
+
+def get_initial_rtt_from_event_log(path):
+    # time from the SYN to the ACK that completes the handshake
+    df = event_log_to_df(path)
+    syn = df[(df['tcp_flags'] & (TCP_SYN | TCP_ACK)) == TCP_SYN]
+    if syn.empty:
+        return 0.0
+    syn_time = syn['time'].iloc[0]
+    client = syn['srcport'].iloc[0]
+    ack = df[(df['srcport'] == client) & (df['tcp_flags'] == TCP_ACK) & (df['time'] > syn_time)]
+    if ack.empty:
+        return 0.0
+    return ack['time'].iloc[0] - syn_time
+
+
 def find_last_not_retransmission(df, current_index):
     current_position = df.index.get_loc(current_index)
     for pos in range(current_position - 1, -1, -1):
@@ -220,9 +286,56 @@ def get_lossEvents_from_server_client_pcaps(server_pcap, client_pcap, server_por
     pkt_filter = "tcp.srcport=={}".format(server_port)
     
     server_df = pcap_to_df(server_pcap, fields.keys(), pkt_filter=pkt_filter).rename(columns=fields)
-    server_df = preprocess_df(server_df)
-    
     client_df = pcap_to_df(client_pcap, fields.keys(), pkt_filter=pkt_filter).rename(columns=fields)
+    return match_loss_events(server_df, client_df)
+
+
+LOSS_MATCHER_SOURCE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "tools", "pcap-loss-matcher.cc")
+LOSS_MATCHER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "tools", "pcap-loss-matcher")
+# mirrors LossRecord in tools/pcap-loss-matcher.cc
+LOSS_RECORD = np.dtype([('timestamp', '<f8'), ('pkt_len', '<u4'), ('seq', '<u4'), ('is_lost', 'u1'), ('reserved', 'V7')])
+
+
+def build_loss_matcher():
+    if os.path.exists(LOSS_MATCHER) and os.path.getmtime(LOSS_MATCHER) >= os.path.getmtime(LOSS_MATCHER_SOURCE):
+        return True
+    command = ["g++", "-O2", "-std=c++17", "-o", LOSS_MATCHER, LOSS_MATCHER_SOURCE]
+    try:
+        subprocess.run(command, check=True, capture_output=True, text=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print("Could not build the pcap loss matcher:", e)
+        return False
+    return True
+
+
+def get_lossEvents_with_matcher(server_pcap, client_pcap, server_port):
+    """Same table as get_lossEvents_from_server_client_pcaps, from tools/pcap-loss-matcher."""
+    if not build_loss_matcher():
+        return None
+    out = tempfile.NamedTemporaryFile(suffix=".bin", delete=False)
+    out.close()
+    try:
+        command = [LOSS_MATCHER, "--server-port", str(server_port), "--ports-only", "--binary",
+                   server_pcap, client_pcap, out.name]
+        subprocess.run(command, check=True, capture_output=True, text=True)
+        records = np.fromfile(out.name, dtype=LOSS_RECORD)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print("pcap loss matcher failed:", e)
+        return None
+    finally:
+        os.remove(out.name)
+    return pd.DataFrame({'timestamp': records['timestamp'], 'pkt_len': records['pkt_len'],
+                         'seq': records['seq'], 'is_lost': records['is_lost'].astype(bool)})
+
+
+def get_lossEvents_from_event_logs(server_log, client_log, server_port):
+    server_df = event_log_to_df(server_log, srcport=server_port)
+    client_df = event_log_to_df(client_log, srcport=server_port)
+    return match_loss_events(server_df, client_df)
+
+
+def match_loss_events(server_df, client_df):
+    server_df = preprocess_df(server_df)
     client_df = preprocess_df(client_df)    
     
     # reset indexing, becaues we filtered by length